@@ -37,6 +37,11 @@
 #include <stddef.h>
 #if defined(__cplusplus)
 # include <complex>
+# if defined(LIBXSTREAM_STDFEATURES)
+#   include <type_traits>
+#   include <utility>
+#   include <tuple>
+# endif
 #endif
 #include "libxstream_end.h"
 
@@ -47,6 +52,8 @@ typedef int libxstream_bool;
 LIBXSTREAM_EXPORT_C typedef struct libxstream_stream libxstream_stream;
 /** Event type. */
 LIBXSTREAM_EXPORT_C typedef struct libxstream_event libxstream_event;
+/** Graph type (work recorded from a stream). */
+LIBXSTREAM_EXPORT_C typedef struct libxstream_graph libxstream_graph;
 /** Enumeration of elemental "scalar" types. */
 LIBXSTREAM_EXPORT_C typedef enum libxstream_type {
   /** special types: BOOL, BYTE, CHAR, VOID */
@@ -79,6 +86,48 @@ LIBXSTREAM_EXPORT_C typedef enum libxstream_call_flags {
   /** collection of any valid flags from above */
   LIBXSTREAM_CALL_DEFAULT = 0
 } libxstream_call_flags;
+/** Statistics about host threads waiting for work or for the completion of work. */
+LIBXSTREAM_EXPORT_C typedef struct libxstream_wait_stats {
+  /** Percentage of the waiting time spent spinning i.e., CPU time burnt while being idle. */
+  double idle_cpu;
+  /** Average and maximum latency (seconds) between a notification and the wake-up of a parked thread. */
+  double wakeup_latency, wakeup_latency_max;
+  /** Accumulated time (seconds) spent spinning respectively parked. */
+  double spin_time, park_time;
+  /** Number of times a waiting thread was parked. */
+  size_t nparked;
+} libxstream_wait_stats;
+/** Statistics about the buffers cached by libxstream_mem_deallocate for reuse by libxstream_mem_allocate. */
+LIBXSTREAM_EXPORT_C typedef struct libxstream_mem_stats {
+  /** Number of allocations served from the cache respectively by allocating memory. */
+  size_t hits, misses;
+  /** Number of Bytes cached currently and at most (peak), number of cached buffers. */
+  size_t cached, cached_max, nbuffers;
+  /** Maximum number of Bytes which can be cached (high-water mark). */
+  size_t limit;
+} libxstream_mem_stats;
+/** Counters of a stream since it was created (see libxstream_stream_stats). */
+LIBXSTREAM_EXPORT_C typedef struct libxstream_stream_counters {
+  /** Number of work items enqueued respectively completed. */
+  size_t nenqueued, ncompleted;
+  /** Number of Bytes transferred host-to-device, device-to-host, and device-to-device. */
+  size_t h2d, d2h, d2d;
+  /** Accumulated time (seconds) work was waiting in the queue respectively was executing. */
+  double queue_time, exec_time;
+  /** Maximum number of work items pending at once (including the executing one). */
+  size_t queue_depth_max;
+} libxstream_stream_counters;
+/** Direction of a transfer (see libxstream_memcpy_2d). */
+LIBXSTREAM_EXPORT_C typedef enum libxstream_memcpy_kind {
+  LIBXSTREAM_MEMCPY_H2D,
+  LIBXSTREAM_MEMCPY_D2H,
+  LIBXSTREAM_MEMCPY_D2D
+} libxstream_memcpy_kind;
+/** Descriptor of a transfer within a batch of transfers (see libxstream_memcpy_h2d_batch). */
+LIBXSTREAM_EXPORT_C typedef struct libxstream_memcpy_desc {
+  /** Source and destination address (can carry an offset), and number of Bytes. */
+  const void* src; void* dst; size_t size;
+} libxstream_memcpy_desc;
 /** Function argument type. */
 LIBXSTREAM_EXPORT_C typedef struct LIBXSTREAM_TARGET(mic) libxstream_argument libxstream_argument;
 /** Function type of an offloadable function. */
@@ -91,8 +140,14 @@ LIBXSTREAM_EXPORT_C int libxstream_get_active_device(int* device);
 /** Set the active device for this thread. */
 LIBXSTREAM_EXPORT_C int libxstream_set_active_device(int device);
 
-/** Query the memory metrics of the device (valid to pass one NULL pointer). */
+/** Query the memory metrics of the device (valid to pass one NULL pointer); allocatable memory includes cached buffers. */
 LIBXSTREAM_EXPORT_C int libxstream_mem_info(int device, size_t* allocatable, size_t* physical);
+/** Query the statistics of the buffers cached for the device (see libxstream_mem_stats). */
+LIBXSTREAM_EXPORT_C int libxstream_get_mem_stats(int device, libxstream_mem_stats* stats);
+/** Set the maximum number of Bytes cached for the device (high-water mark); trims the cache accordingly. */
+LIBXSTREAM_EXPORT_C int libxstream_mem_pool_limit(int device, size_t limit);
+/** Deallocate cached buffers of the device (largest first) until at most the given number of Bytes is cached. */
+LIBXSTREAM_EXPORT_C int libxstream_mem_trim(int device, size_t size);
 /** Query the real pointer on the device side; both pointers are equal if the device specifies the host. */
 LIBXSTREAM_EXPORT_C int libxstream_mem_pointer(int device, const void* memory, const void** real);
 /** Allocate aligned memory (0: automatic) on the device. */
@@ -107,6 +162,21 @@ LIBXSTREAM_EXPORT_C int libxstream_memcpy_h2d(const void* host_mem, void* dev_me
 LIBXSTREAM_EXPORT_C int libxstream_memcpy_d2h(const void* dev_mem, void* host_mem, size_t size, libxstream_stream* stream);
 /** Copy memory from device to device; cross-device copies are allowed as well. */
 LIBXSTREAM_EXPORT_C int libxstream_memcpy_d2d(const void* src, void* dst, size_t size, libxstream_stream* stream);
+/** Copy a batch of buffers from the host to the device (one work item); contiguous neighbors are merged. */
+LIBXSTREAM_EXPORT_C int libxstream_memcpy_h2d_batch(const libxstream_memcpy_desc batch[], size_t nbatch, libxstream_stream* stream);
+/** Copy a batch of buffers from the device to the host (one work item); contiguous neighbors are merged. */
+LIBXSTREAM_EXPORT_C int libxstream_memcpy_d2h_batch(const libxstream_memcpy_desc batch[], size_t nbatch, libxstream_stream* stream);
+/**
+ * Copy a block of extent[0] x extent[1] elements (typesize Bytes) between two-dimensional arrays (column-major) with
+ * the given (leading) dimensions (pitch); the offsets (elements) locate the block within the source and the destination.
+ */
+LIBXSTREAM_EXPORT_C int libxstream_memcpy_2d(const void* src, void* dst, size_t typesize, const size_t extent[2],
+  const int src_offset[2], const size_t src_pitch[2], const int dst_offset[2], const size_t dst_pitch[2],
+  libxstream_memcpy_kind kind, libxstream_stream* stream);
+/** Copy a block of extent[0] x extent[1] x extent[2] elements between three-dimensional arrays (see libxstream_memcpy_2d). */
+LIBXSTREAM_EXPORT_C int libxstream_memcpy_3d(const void* src, void* dst, size_t typesize, const size_t extent[3],
+  const int src_offset[3], const size_t src_pitch[3], const int dst_offset[3], const size_t dst_pitch[3],
+  libxstream_memcpy_kind kind, libxstream_stream* stream);
 
 /** Query the range of valid priorities (inclusive bounds). */
 LIBXSTREAM_EXPORT_C int libxstream_stream_priority_range(int* least, int* greatest);
@@ -118,6 +188,12 @@ LIBXSTREAM_EXPORT_C int libxstream_stream_destroy(const libxstream_stream* strea
 LIBXSTREAM_EXPORT_C int libxstream_stream_sync(libxstream_stream* stream);
 /** Wait for an event inside the specified stream; a NULL-stream matches all streams. */
 LIBXSTREAM_EXPORT_C int libxstream_stream_wait_event(const libxstream_stream* stream, const libxstream_event* event);
+/**
+ * Call fn(data) on the host once the work enqueued so far is completed; the callback is executed
+ * by the thread executing the stream, and subsequent work of the stream waits for the callback.
+ * A NULL-stream matches all streams (the callback does not hold back any stream).
+ */
+LIBXSTREAM_EXPORT_C int libxstream_stream_add_callback(libxstream_stream* stream, void (*fn)(void*), void* data);
 /** Lock a stream such that the caller thread can safely enqueue work. */
 LIBXSTREAM_EXPORT_C int libxstream_stream_lock(libxstream_stream* stream);
 /** Unlock a stream such that another thread can acquire the stream. */
@@ -126,6 +202,8 @@ LIBXSTREAM_EXPORT_C int libxstream_stream_unlock(libxstream_stream* stream);
 LIBXSTREAM_EXPORT_C int libxstream_stream_device(const libxstream_stream* stream, int* device);
 /** Query the device the given stream is constructed for. */
 LIBXSTREAM_EXPORT_C int libxstream_stream_demux(const libxstream_stream* stream, int* demux);
+/** Query the counters of a stream; cheap enough to be called at any time (counters of pending work are not yet included). */
+LIBXSTREAM_EXPORT_C int libxstream_stream_stats(const libxstream_stream* stream, libxstream_stream_counters* stats);
 
 /** Create an event; can be used multiple times to record an event. */
 LIBXSTREAM_EXPORT_C int libxstream_event_create(libxstream_event** event);
@@ -137,6 +215,40 @@ LIBXSTREAM_EXPORT_C int libxstream_event_record(libxstream_event* event, libxstr
 LIBXSTREAM_EXPORT_C int libxstream_event_query(const libxstream_event* event, libxstream_bool* occured);
 /** Wait for an event to complete i.e., work queued prior to recording the event. */
 LIBXSTREAM_EXPORT_C int libxstream_event_synchronize(libxstream_event* event);
+/**
+ * Call fn(data) on the host once the event occurred; the callback is executed by the thread completing
+ * the recorded work (or by the caller if the event already occurred). The event can be re-recorded
+ * or destroyed afterwards (the callback refers to the work recorded at the time of the call).
+ */
+LIBXSTREAM_EXPORT_C int libxstream_event_add_callback(const libxstream_event* event, void (*fn)(void*), void* data);
+
+/**
+ * Record (rather than execute) the work enqueued into the stream until libxstream_graph_end; recording
+ * covers event records and event waits of this stream but no synchronous calls (e.g., libxstream_stream_sync).
+ */
+LIBXSTREAM_EXPORT_C int libxstream_graph_begin(libxstream_stream* stream);
+/** Stop recording and receive the recorded work; an empty graph is created if nothing was enqueued. */
+LIBXSTREAM_EXPORT_C int libxstream_graph_end(libxstream_stream* stream, libxstream_graph** graph);
+/** Replace a pointer argument of the recorded work (exact match) e.g., to launch the graph for other buffers. */
+LIBXSTREAM_EXPORT_C int libxstream_graph_update(libxstream_graph* graph, const void* from, const void* to, size_t* nupdated);
+/** Enqueue the recorded work into the stream it was recorded from; the graph must not change until completed. */
+LIBXSTREAM_EXPORT_C int libxstream_graph_launch(libxstream_graph* graph);
+/** Destroy a graph; launched work must be completed. */
+LIBXSTREAM_EXPORT_C int libxstream_graph_destroy(const libxstream_graph* graph);
+
+/**
+ * Start recording a timeline of all enqueued work (LIBXSTREAM_TIMELINE); the timeline is written into the given file
+ * at shutdown (Chrome trace format), and a previously given file is kept if filename is NULL. Setting the environment
+ * variable LIBXSTREAM_TIMELINE=<filename> is equivalent to enabling the timeline at startup.
+ */
+LIBXSTREAM_EXPORT_C int libxstream_timeline_enable(const char* filename);
+/** Stop recording the timeline; the records are kept (see libxstream_timeline_write). */
+LIBXSTREAM_EXPORT_C int libxstream_timeline_disable(void);
+/** Write the recorded timeline (Chrome trace format e.g., for chrome://tracing or Perfetto). */
+LIBXSTREAM_EXPORT_C int libxstream_timeline_write(const char* filename);
+
+/** Query statistics about host threads waiting for work or for the completion of work (since startup). */
+LIBXSTREAM_EXPORT_C int libxstream_get_wait_stats(libxstream_wait_stats* stats);
 
 /** Create a function signature with a certain maximum number of arguments. */
 LIBXSTREAM_EXPORT_C int libxstream_fn_create_signature(libxstream_argument** signature, size_t nargs);
@@ -156,6 +268,24 @@ LIBXSTREAM_EXPORT_C int libxstream_fn_inout(libxstream_argument* signature, size
 LIBXSTREAM_EXPORT_C int libxstream_fn_nargs(const libxstream_argument* signature, size_t* nargs);
 /** Call a user function along with the signature; wait in case of a synchronous call. */
 LIBXSTREAM_EXPORT_C int libxstream_fn_call(libxstream_function function, const libxstream_argument* signature, libxstream_stream* stream, int flags);
+/**
+ * Register a copy of the signature such that calls refer to it by handle (libxstream_fn_call_registered) rather than copying
+ * the arguments per call; the handle is a valid signature (the data bound to it must stay valid until the calls are completed).
+ */
+LIBXSTREAM_EXPORT_C int libxstream_fn_register_signature(const libxstream_argument* signature, const libxstream_argument** handle);
+/** Release a registered signature (libxstream_fn_register_signature); calls which are not completed yet keep it alive. */
+LIBXSTREAM_EXPORT_C int libxstream_fn_unregister_signature(const libxstream_argument* handle);
+/**
+ * Call a user function along with a registered signature; values[i] (if not NULL) replaces the i-th argument for this call only
+ * (scalars are copied, arrays are given by pointer), and only the replaced arguments are copied per call (nvalues <= arity).
+ */
+LIBXSTREAM_EXPORT_C int libxstream_fn_call_registered(libxstream_function function, const libxstream_argument* handle,
+  const void* values[], size_t nvalues, libxstream_stream* stream, int flags);
+/**
+ * Enqueue a host function along with application-defined data (see libxstream::enqueue); run(data) is called within the stream,
+ * and destroy(data) is called (if not NULL) once the work is released i.e., the data is owned by the library (even if enqueuing fails).
+ */
+LIBXSTREAM_EXPORT_C int libxstream_fn_enqueue(void (*run)(void*), void (*destroy)(void*), void* data, libxstream_stream* stream, int flags);
 
 /** Query the size of the elemental type (Byte). */
 LIBXSTREAM_EXPORT_C LIBXSTREAM_TARGET(mic) int libxstream_get_typesize(libxstream_type type, size_t* typesize);
@@ -233,6 +363,39 @@ template<> struct libxstream_map_from<LIBXSTREAM_TYPE_C32>
 template<> struct libxstream_map_from<LIBXSTREAM_TYPE_C64>                        { typedef std::complex<double> type; typedef double ctype[2]; };
 template<> struct libxstream_map_from<LIBXSTREAM_TYPE_CHAR>                       { typedef char type; };
 template<> struct libxstream_map_from<LIBXSTREAM_TYPE_VOID>                       { typedef void type; };
+
+#if defined(LIBXSTREAM_STDFEATURES)
+namespace libxstream_enqueue_internal {
+template<size_t...> struct index_sequence {};
+template<size_t N, size_t... I> struct make_index_sequence: make_index_sequence<N - 1, N - 1, I...> {};
+template<size_t... I> struct make_index_sequence<0, I...> { typedef index_sequence<I...> type; };
+
+/** Function and arguments stored by value (tuple); the signature is known at compile-time. */
+template<typename F, typename... A> class call_type {
+public:
+  template<typename G, typename... B> explicit call_type(G&& function, B&&... args)
+    : m_function(std::forward<G>(function)), m_arguments(std::forward<B>(args)...) {}
+  static void run(void* data) { static_cast<call_type*>(data)->invoke(typename make_index_sequence<sizeof...(A)>::type()); }
+  static void destroy(void* data) { delete static_cast<call_type*>(data); }
+private:
+  template<size_t... I> void invoke(index_sequence<I...>) { m_function(std::get<I>(m_arguments)...); }
+  F m_function;
+  std::tuple<A...> m_arguments;
+};
+} // namespace libxstream_enqueue_internal
+
+namespace libxstream {
+/**
+ * Enqueue a host function (or any callable) along with its arguments; the signature is deduced at compile-time,
+ * and the arguments are stored by value (a pointer or std::ref refers to data which must be valid when executed).
+ */
+template<typename F, typename... A> int enqueue(libxstream_stream* stream, F&& function, A&&... args) {
+  typedef libxstream_enqueue_internal::call_type<typename std::decay<F>::type, typename std::decay<A>::type...> call_type;
+  call_type *const call = new call_type(std::forward<F>(function), std::forward<A>(args)...);
+  return libxstream_fn_enqueue(call_type::run, call_type::destroy, call, stream, LIBXSTREAM_CALL_DEFAULT);
+}
+} // namespace libxstream
+#endif /*LIBXSTREAM_STDFEATURES*/
 #endif /*__cplusplus*/
 
 #endif /*LIBXSTREAM_H*/
@@ -60,6 +60,20 @@
  */
 #define LIBXSTREAM_TRACE
 
+/**
+ * Number of records in the ring buffer of the timeline (libxstream_timeline_enable);
+ * each enqueued work item is recorded (label, stream, device, Bytes, and the time of
+ * enqueuing, starting, and finishing) once the timeline is enabled at runtime, and
+ * the most recent records are exported in Chrome trace format (JSON).
+ */
+#define LIBXSTREAM_TIMELINE 65536
+
+/**
+ * Accumulates the time work items are waiting in the queue respectively executing
+ * (libxstream_stream_stats); costs three time stamps per enqueued work item.
+ */
+#define LIBXSTREAM_STREAM_TIMES
+
 /**
  * Enables asynchronous offloads.
  * Valid selections:
@@ -71,12 +85,79 @@
  */
 #define LIBXSTREAM_ASYNC 0
 
-/** Not implemented yet. Must be disabled. */
-/*#define LIBXSTREAM_ASYNCHOST*/
+/**
+ * Executes the streams on the host using a pool of threads (work stealing)
+ * rather than using a dedicated background thread per stream.
+ */
+#define LIBXSTREAM_ASYNCHOST
+
+/**
+ * Exposes the NUMA domains of the host as devices unless offloading to a coprocessor
+ * (libxstream_get_ndevices); the host threads executing the streams of a device are
+ * pinned to the CPUs of the domain, and memory allocated for the device is bound to
+ * the domain (Linux).
+ */
+#define LIBXSTREAM_NUMA
 
-/** Not implemented yet. Must be disabled. */
+/**
+ * Number of virtual devices unless offloading to a coprocessor i.e., the CPUs of the host are
+ * partitioned into groups of (almost) equal size, each with own host threads and memory pool;
+ * zero exposes the NUMA domains (LIBXSTREAM_NUMA). Setting LIBXSTREAM_NDEVICES=<n> in the
+ * environment takes precedence.
+ */
+#define LIBXSTREAM_NDEVICES 0
+
+/** Number of host threads executing the streams (LIBXSTREAM_ASYNCHOST); zero selects the number of cores (per NUMA domain). */
+#define LIBXSTREAM_ASYNCHOST_NTHREADS 0
+
+/** Number of work items a host thread executes per stream before moving on (LIBXSTREAM_ASYNCHOST). */
+#define LIBXSTREAM_ASYNCHOST_BATCH 16
+
+/**
+ * Number of stream priorities distinguished by the host threads (LIBXSTREAM_ASYNCHOST);
+ * zero is the least (default) priority and negative values are more urgent
+ * (see libxstream_stream_priority_range).
+ */
+#define LIBXSTREAM_PRIORITY_NLEVELS 3
+
+/**
+ * Number of times a host thread prefers a more urgent stream over streams of lower
+ * priority which are waiting as well; the least urgent stream is served afterwards
+ * such that streams of lower priority do not starve.
+ */
+#define LIBXSTREAM_PRIORITY_AGING 8
+
+/**
+ * Allocates host buffers (libxstream_mem_allocate) using page-locked memory such that
+ * staging buffers do not page-fault on first touch; large buffers are backed by huge
+ * pages. Pageable memory (prefaulted) is used if the memory cannot be locked e.g.,
+ * if RLIMIT_MEMLOCK is too small.
+ * Valid selections:
+ * - #define LIBXSTREAM_ALLOC_PINNED: enables default (1) behavior
+ * - #define LIBXSTREAM_ALLOC_PINNED 1: transparent huge pages
+ * - #define LIBXSTREAM_ALLOC_PINNED 2: explicit huge pages (if reserved by the system)
+ */
 /*#define LIBXSTREAM_ALLOC_PINNED*/
 
+/**
+ * Deallocated buffers are cached per device and reused by subsequent allocations
+ * of the same size class; the value is the default high-water mark i.e., the
+ * maximum number of Bytes cached per device (see libxstream_mem_pool_limit).
+ */
+#define LIBXSTREAM_MEM_POOL (256 << 20)
+
+/**
+ * Minimum number of Bytes copied or cleared by the host fallback such that the work is
+ * distributed across threads (OpenMP); applies to batches of transfers as a whole.
+ */
+#define LIBXSTREAM_MEMCPY_PARALLEL (1 << 20)
+
+/**
+ * Minimum number of Bytes copied or cleared by the host fallback such that the destination
+ * is written using non-temporal (streaming) stores i.e., without polluting the caches.
+ */
+#define LIBXSTREAM_MEMCPY_STREAMING (8 << 20)
+
 /** SIMD width in Byte (actual alignment might be smaller). */
 #define LIBXSTREAM_MAX_SIMD 64
 
@@ -86,35 +167,51 @@
 /** Maximum number of devices. */
 #define LIBXSTREAM_MAX_NDEVICES 8
 
-/** Maximum number of streams per device. */
+/** Number of streams per device the samples are prepared for (the library does not limit the number of streams). */
 #define LIBXSTREAM_MAX_NSTREAMS 32
 
 /** Maximum dimensionality of arrays. */
-#define LIBXSTREAM_MAX_NDIMS 4
+#define LIBXSTREAM_MAX_NDIMS 8
+
+/**
+ * Maximum number of arguments in offload structure (up to 32); offloading to a device is limited
+ * to 16 arguments which are arrays or outputs (the host fallback is not limited).
+ */
+#define LIBXSTREAM_MAX_NARGS 32
 
-/** Maximum number of arguments in offload structure. */
-#define LIBXSTREAM_MAX_NARGS 16
+/**
+ * Number of arguments held by an enqueued work item without allocating memory;
+ * the arguments of larger signatures are allocated on the heap.
+ */
+#define LIBXSTREAM_CAPTURE_NARGS 8
 
 /** Maximum number of executions in the queue. */
 #define LIBXSTREAM_MAX_QSIZE 1024
 
-/** Maximum number of host threads. */
-#define LIBXSTREAM_MAX_NTHREADS 1024
+/**
+ * Enqueuing work into a full queue fails (LIBXSTREAM_ERROR_RUNTIME)
+ * rather than blocking the caller until an entry becomes available.
+ */
+/*#define LIBXSTREAM_QUEUE_NOWAIT*/
 
 /**
- * Number of times a locked stream must be discovered to be
- * "not alive" before unlocking the stream in question.
+ * Enqueued capture regions are recycled using an arena per producer thread
+ * rather than allocating each region on the heap; the value is the number
+ * of regions allocated at once when an arena is exhausted.
  */
-#define LIBXSTREAM_LOCK_RETRY 3
+#define LIBXSTREAM_CAPTURE_ARENA 64
+
+/** Maximum number of host threads. */
+#define LIBXSTREAM_MAX_NTHREADS 1024
 
 /** Enables non-recursive locks. */
 #define LIBXSTREAM_LOCK_NONRECURSIVE
 
-/** Number of milliseconds a lock can stall. */
-#define LIBXSTREAM_WAIT_LOCK_MS 200
-
-/** Number of cycles to actively wait. */
-#define LIBXSTREAM_WAIT_ACTIVE_CYCLES 10000
+/**
+ * Upper bound (microseconds) of the adaptive spin phase before a waiting thread
+ * is parked; the actual budget is learned from the recent waiting times.
+ */
+#define LIBXSTREAM_WAIT_SPIN_US 200
 
 /**
  * Thread-local signals allow for some more concurrency
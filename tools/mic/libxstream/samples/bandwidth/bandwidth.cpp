@@ -0,0 +1,144 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#include "../../include/libxstream.h"
+#include "../../include/libxstream_begin.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#if defined(_OPENMP)
+# include <omp.h>
+#endif
+#include "../../include/libxstream_end.h"
+
+
+namespace bandwidth_internal {
+
+double seconds()
+{
+  typedef std::chrono::steady_clock clock_type;
+  static const clock_type::time_point start = clock_type::now();
+  return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+
+// bandwidth in GB/s; counts the Bytes read and written
+double gbs(size_t size, int nrepeat, double duration)
+{
+  return 2E-9 * size * nrepeat / std::max(duration, 1E-9);
+}
+
+} // namespace bandwidth_internal
+
+
+int main(int argc, char* argv[])
+{
+  try {
+    const size_t max_size = static_cast<size_t>(std::max(1 < argc ? std::atoi(argv[1]) : 256, 1)) << 20;
+    const int nrepeat = std::max(2 < argc ? std::atoi(argv[2]) : 8, 1);
+    const size_t min_size = 4096;
+
+    size_t ndevices = 0;
+    if (LIBXSTREAM_ERROR_NONE != libxstream_get_ndevices(&ndevices) || 0 == ndevices) {
+      throw std::runtime_error("no device found!");
+    }
+#if !defined(_OPENMP)
+    fprintf(stderr, "Warning: OpenMP support needed for multi-threaded results.\n");
+#endif
+
+    const int device = 0;
+    libxstream_stream* stream = 0;
+    void *hst = 0, *ref = 0, *dev = 0;
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_create(&stream, device, 0, 0, 0));
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_allocate(-1, &hst, max_size, 0));
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_allocate(-1, &ref, max_size, 0));
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_allocate(device, &dev, max_size, 0));
+    memset(hst, 1, max_size);
+    memset(ref, 1, max_size);
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_memset_zero(dev, max_size, stream));
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(stream));
+
+    fprintf(stdout, "Size [Byte]\th2d [GB/s]\td2h [GB/s]\tzero [GB/s]\tmemcpy [GB/s]\n");
+    for (size_t size = min_size; size <= max_size; size *= 2) {
+      double start = bandwidth_internal::seconds();
+      for (int i = 0; i < nrepeat; ++i) {
+        LIBXSTREAM_CHECK_CALL_THROW(libxstream_memcpy_h2d(hst, dev, size, stream));
+      }
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(stream));
+      const double h2d = bandwidth_internal::seconds() - start;
+
+      start = bandwidth_internal::seconds();
+      for (int i = 0; i < nrepeat; ++i) {
+        LIBXSTREAM_CHECK_CALL_THROW(libxstream_memcpy_d2h(dev, hst, size, stream));
+      }
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(stream));
+      const double d2h = bandwidth_internal::seconds() - start;
+
+      start = bandwidth_internal::seconds();
+      for (int i = 0; i < nrepeat; ++i) {
+        LIBXSTREAM_CHECK_CALL_THROW(libxstream_memset_zero(dev, size, stream));
+      }
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(stream));
+      const double zero = bandwidth_internal::seconds() - start;
+
+      // reference: single-threaded copy by the calling thread (host only)
+      start = bandwidth_internal::seconds();
+      for (int i = 0; i < nrepeat; ++i) {
+        memcpy(ref, hst, size);
+      }
+      const double host = bandwidth_internal::seconds() - start;
+
+      fprintf(stdout, "%lu\t%.1f\t%.1f\t%.1f\t%.1f\n", static_cast<unsigned long>(size),
+        bandwidth_internal::gbs(size, nrepeat, h2d),
+        bandwidth_internal::gbs(size, nrepeat, d2h),
+        0.5 * bandwidth_internal::gbs(size, nrepeat, zero), // write only
+        bandwidth_internal::gbs(size, nrepeat, host));
+    }
+
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_deallocate(-1, hst));
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_deallocate(-1, ref));
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_deallocate(device, dev));
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_destroy(stream));
+    fprintf(stdout, "Finished\n");
+  }
+  catch(const std::exception& e) {
+    fprintf(stderr, "Error: %s\n", e.what());
+    return EXIT_FAILURE;
+  }
+  catch(...) {
+    fprintf(stderr, "Error: unknown exception caught!\n");
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#include "../../include/libxstream.h"
+#include "../../include/libxstream_begin.h"
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#if defined(_OPENMP)
+# include <omp.h>
+#endif
+#include "../../include/libxstream_end.h"
+
+
+namespace demux_internal {
+
+double seconds()
+{
+  typedef std::chrono::steady_clock clock_type;
+  static const clock_type::time_point start = clock_type::now();
+  return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+} // namespace demux_internal
+
+
+int main(int argc, char* argv[])
+{
+  try {
+#if defined(_OPENMP)
+    const int nthreads = std::max(1 < argc ? std::atoi(argv[1]) : std::max(omp_get_max_threads(), 4), 1);
+#else
+    const int nthreads = 1;
+#endif
+    const int nstreams = std::max(2 < argc ? std::atoi(argv[2]) : 2, 1);
+    const int nrounds = std::max(3 < argc ? std::atoi(argv[3]) : 1000, 1);
+    const int nitems = std::max(4 < argc ? std::atoi(argv[4]) : 4, 1);
+    const size_t size = 8;
+
+    size_t ndevices = 0;
+    if (LIBXSTREAM_ERROR_NONE != libxstream_get_ndevices(&ndevices) || 0 == ndevices) {
+      throw std::runtime_error("no device found!");
+    }
+#if !defined(_OPENMP)
+    fprintf(stderr, "Warning: OpenMP support needed for multi-threaded results.\n");
+#endif
+
+    // all threads share the streams (automatic demux); a thread does not synchronize the
+    // stream it owns but moves on to the next stream i.e., the owner is idle or waiting
+    std::vector<libxstream_stream*> stream(nstreams, static_cast<libxstream_stream*>(0));
+    std::vector<void*> buffer(nthreads, static_cast<void*>(0));
+    for (int i = 0; i < nstreams; ++i) {
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_create(&stream[i], static_cast<int>(i % ndevices), -1, 0, 0));
+    }
+    for (int i = 0; i < nthreads; ++i) {
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_allocate(-1, &buffer[i], size, 0));
+    }
+
+    fprintf(stdout, "Handing over %i stream%s between %i thread%s (%i rounds of %i regions)...\n",
+      nstreams, 1 < nstreams ? "s" : "", nthreads, 1 < nthreads ? "s" : "", nrounds, nitems);
+    double maximum = 0, total = 0;
+    const double start = demux_internal::seconds();
+#if defined(_OPENMP)
+#   pragma omp parallel num_threads(nthreads) reduction(max:maximum) reduction(+:total)
+#endif
+    {
+#if defined(_OPENMP)
+      const int tid = omp_get_thread_num();
+#else
+      const int tid = 0;
+#endif
+      for (int r = 0; r < nrounds; ++r) {
+        libxstream_stream *const s = stream[(tid + r) % nstreams];
+        for (int i = 0; i < nitems; ++i) {
+          const double begin = demux_internal::seconds();
+          LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_memset_zero(buffer[tid], size, s));
+          const double duration = demux_internal::seconds() - begin;
+          maximum = std::max(maximum, duration);
+          total += duration;
+        }
+#if defined(_OPENMP)
+        // owners are waiting for each other (no stream is synchronized)
+#       pragma omp barrier
+#endif
+      }
+    }
+    const double enqueued = demux_internal::seconds();
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(0));
+    const double drained = demux_internal::seconds();
+
+    const double nenqueues = static_cast<double>(nrounds) * nitems * nthreads;
+    fprintf(stdout, "Enqueue:\t%.3f us average\t%.3f ms maximum (handover)\n", total * 1E6 / nenqueues, maximum * 1E3);
+    fprintf(stdout, "Duration:\t%.1f ms\t(drained after %.1f ms)\n", (enqueued - start) * 1E3, (drained - start) * 1E3);
+
+    for (int i = 0; i < nthreads; ++i) {
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_deallocate(-1, buffer[i]));
+    }
+    for (int i = 0; i < nstreams; ++i) {
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_destroy(stream[i]));
+    }
+    fprintf(stdout, "Finished\n");
+  }
+  catch(const std::exception& e) {
+    fprintf(stderr, "Error: %s\n", e.what());
+    return EXIT_FAILURE;
+  }
+  catch(...) {
+    fprintf(stderr, "Error: unknown exception caught!\n");
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
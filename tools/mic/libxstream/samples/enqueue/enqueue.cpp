@@ -0,0 +1,123 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#include "../../include/libxstream.h"
+#include "../../include/libxstream_begin.h"
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#if defined(_OPENMP)
+# include <omp.h>
+#endif
+#include "../../include/libxstream_end.h"
+
+
+namespace enqueue_internal {
+
+double seconds()
+{
+  typedef std::chrono::steady_clock clock_type;
+  static const clock_type::time_point start = clock_type::now();
+  return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+} // namespace enqueue_internal
+
+
+int main(int argc, char* argv[])
+{
+  try {
+    const int nitems = std::max(1 < argc ? std::atoi(argv[1]) : 20000, 1);
+    const int max_nthreads = std::max(2 < argc ? std::atoi(argv[2]) : 64, 1);
+    const size_t size = static_cast<size_t>(std::max(3 < argc ? std::atoi(argv[3]) : 8, 1));
+
+    size_t ndevices = 0;
+    if (LIBXSTREAM_ERROR_NONE != libxstream_get_ndevices(&ndevices) || 0 == ndevices) {
+      throw std::runtime_error("no device found!");
+    }
+#if !defined(_OPENMP)
+    fprintf(stderr, "Warning: OpenMP support needed for multi-threaded results.\n");
+#endif
+
+    fprintf(stdout, "Enqueuing %i regions of %lu Byte per thread...\n", nitems, static_cast<unsigned long>(size));
+    for (int nthreads = 1; nthreads <= max_nthreads; nthreads *= 2) {
+      // each thread owns a stream (demux=0 without locking the stream)
+      std::vector<libxstream_stream*> stream(nthreads, static_cast<libxstream_stream*>(0));
+      std::vector<void*> buffer(nthreads, static_cast<void*>(0));
+      for (int i = 0; i < nthreads; ++i) {
+        const int device = static_cast<int>(i % ndevices);
+        LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_create(&stream[i], device, 0, 0, 0));
+        LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_allocate(device, &buffer[i], size, 0));
+      }
+
+      const double start = enqueue_internal::seconds();
+#if defined(_OPENMP)
+#     pragma omp parallel for num_threads(nthreads) schedule(static,1)
+#endif
+      for (int i = 0; i < nthreads; ++i) {
+        libxstream_stream *const s = stream[i];
+        void *const b = buffer[i];
+        for (int j = 0; j < nitems; ++j) {
+          LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_memset_zero(b, size, s));
+        }
+      }
+      const double enqueued = enqueue_internal::seconds();
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(0));
+      const double drained = enqueue_internal::seconds();
+
+      const double nenqueues = static_cast<double>(nitems) * nthreads;
+      fprintf(stdout, "%i thread%s:\t%.2f M enqueues/s\t%.3f us per enqueue\t(drained after %.1f ms)\n",
+        nthreads, 1 < nthreads ? "s" : "",
+        nenqueues * 1E-6 / std::max(enqueued - start, 1E-9),
+        (enqueued - start) * 1E6 / nenqueues,
+        (drained - start) * 1E3);
+
+      for (int i = 0; i < nthreads; ++i) {
+        const int device = static_cast<int>(i % ndevices);
+        LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_deallocate(device, buffer[i]));
+        LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_destroy(stream[i]));
+      }
+    }
+    fprintf(stdout, "Finished\n");
+  }
+  catch(const std::exception& e) {
+    fprintf(stderr, "Error: %s\n", e.what());
+    return EXIT_FAILURE;
+  }
+  catch(...) {
+    fprintf(stderr, "Error: unknown exception caught!\n");
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
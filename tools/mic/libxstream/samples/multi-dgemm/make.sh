@@ -6,7 +6,7 @@ NAME=$(basename ${PWD})
 ICCOPT="-O2 -xHost -ansi-alias -offload-option,mic,compiler,\"-L${MKLROOT}/lib/mic\""
 ICCLNK="-mkl"
 
-GCCOPT="-O2 -march=native"
+GCCOPT="-O3 -march=native"
 GCCLNK="-llapack -lblas"
 
 OPT="-Wall -std=c++0x"
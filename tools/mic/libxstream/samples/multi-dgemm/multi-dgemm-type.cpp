@@ -36,32 +36,23 @@
 #include "../../include/libxstream_end.h"
 
 
-multi_dgemm_type::host_data_type::host_data_type(libxstream_function process, size_t size, const size_t split[])
+multi_dgemm_type::host_data_type::host_data_type(libxstream_function process, size_t size, const size_t split[], const size_t sizes[])
   : m_process(process)
   , m_adata(0), m_bdata(0), m_cdata(0), m_idata(0)
   , m_size(size), m_flops(0)
 {
   LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_allocate(-1, reinterpret_cast<void**>(&m_idata), sizeof(size_t) * (size + 1), 0));
 
-  size_t isize = split[0];
-  size_t msize = 0, n = 100, nn = n * n;
-  for (size_t i = 0; i < isize; ++i) {
-    m_flops += nn * (2 * n + 1);
-    m_idata[i] = msize;
-    msize += nn;
-  }
-  isize += split[1];
-  n = 600, nn = n * n;
-  for (size_t i = split[0]; i < isize; ++i) {
-    m_flops += nn * (2 * n + 1);
-    m_idata[i] = msize;
-    msize += nn;
-  }
-  n = 1000, nn = n * n;
-  for (size_t i = isize; i < size; ++i) {
-    m_flops += nn * (2 * n + 1);
-    m_idata[i] = msize;
-    msize += nn;
+  // items are ordered by problem size: split[0] items of sizes[0], split[1] items of sizes[1], and the remainder of sizes[2]
+  const size_t end[] = { std::min(split[0], size), std::min(split[0] + split[1], size), size };
+  size_t msize = 0, i = 0;
+  for (size_t j = 0; j < 3; ++j) {
+    const size_t n = sizes[j], nn = n * n;
+    for (; i < end[j]; ++i) {
+      m_flops += nn * (2 * n + 1);
+      m_idata[i] = msize;
+      msize += nn;
+    }
   }
   m_idata[size] = msize;
 
@@ -116,7 +107,7 @@ bool multi_dgemm_type::host_data_type::ready() const
 multi_dgemm_type::multi_dgemm_type()
   : m_host_data(0), m_signature(0), m_stream(0), m_event(0)
   , m_adata(0), m_bdata(0), m_cdata(0)
-  , m_idata(0), m_max_batch(0)
+  , m_idata(0), m_max_batch(0), m_nthreads(0)
 {}
 
 
@@ -131,7 +122,7 @@ int multi_dgemm_type::deinit()
   if (m_host_data) {
     int device = -1;
     LIBXSTREAM_CHECK_CALL(libxstream_stream_device(m_stream, &device));
-    LIBXSTREAM_CHECK_CALL(libxstream_fn_destroy_signature(m_signature));
+    LIBXSTREAM_CHECK_CALL(libxstream_fn_unregister_signature(m_signature));
     LIBXSTREAM_CHECK_CALL(libxstream_stream_destroy(m_stream));
     LIBXSTREAM_CHECK_CALL(libxstream_event_destroy(m_event));
     LIBXSTREAM_CHECK_CALL(libxstream_mem_deallocate(device, m_adata));
@@ -155,12 +146,13 @@ int multi_dgemm_type::deinit()
 }
 
 
-int multi_dgemm_type::init(const char* name, host_data_type& host_data, int device, int demux, size_t max_batch)
+int multi_dgemm_type::init(const char* name, host_data_type& host_data, int device, int demux, size_t max_batch, size_t nthreads)
 {
   LIBXSTREAM_CHECK_CALL(deinit());
   const size_t max_msize = max_batch * host_data.max_matrix_size();
   m_host_data = &host_data;
   m_max_batch = max_batch;
+  m_nthreads = nthreads;
 
   LIBXSTREAM_CHECK_CALL(libxstream_stream_create(&m_stream, device, demux, 0, name));
   LIBXSTREAM_CHECK_CALL(libxstream_mem_allocate(device, reinterpret_cast<void**>(&m_adata), sizeof(double) * max_msize, 0));
@@ -168,11 +160,18 @@ int multi_dgemm_type::init(const char* name, host_data_type& host_data, int devi
   LIBXSTREAM_CHECK_CALL(libxstream_mem_allocate(device, reinterpret_cast<void**>(&m_cdata), sizeof(double) * max_msize, 0));
   LIBXSTREAM_CHECK_CALL(libxstream_mem_allocate(device, reinterpret_cast<void**>(&m_idata), sizeof(size_t) * max_batch, 0));
 
-  LIBXSTREAM_CHECK_CALL(libxstream_fn_create_signature(&m_signature, 6));
-  LIBXSTREAM_CHECK_CALL(libxstream_fn_input (m_signature, 2, m_idata, libxstream_map_to_type(m_idata), 1, &max_msize));
-  LIBXSTREAM_CHECK_CALL(libxstream_fn_input (m_signature, 3, m_adata, libxstream_map_to_type(m_adata), 1, &max_msize));
-  LIBXSTREAM_CHECK_CALL(libxstream_fn_input (m_signature, 4, m_bdata, libxstream_map_to_type(m_bdata), 1, &max_msize));
-  LIBXSTREAM_CHECK_CALL(libxstream_fn_output(m_signature, 5, m_cdata, libxstream_map_to_type(m_cdata), 1, &max_msize));
+  // the signature is registered once; the calls only replace the scalar arguments (size, nn, nthreads)
+  libxstream_argument* signature = 0;
+  const size_t size = 0;
+  LIBXSTREAM_CHECK_CALL(libxstream_fn_signature(&signature));
+  LIBXSTREAM_CHECK_CALL(libxstream_fn_input (signature, 0, &size, libxstream_map_to_type(size), 0, 0));
+  LIBXSTREAM_CHECK_CALL(libxstream_fn_input (signature, 1, &size, libxstream_map_to_type(size), 0, 0));
+  LIBXSTREAM_CHECK_CALL(libxstream_fn_input (signature, 2, &size, libxstream_map_to_type(size), 0, 0));
+  LIBXSTREAM_CHECK_CALL(libxstream_fn_input (signature, 3, m_idata, libxstream_map_to_type(m_idata), 1, &max_msize));
+  LIBXSTREAM_CHECK_CALL(libxstream_fn_input (signature, 4, m_adata, libxstream_map_to_type(m_adata), 1, &max_msize));
+  LIBXSTREAM_CHECK_CALL(libxstream_fn_input (signature, 5, m_bdata, libxstream_map_to_type(m_bdata), 1, &max_msize));
+  LIBXSTREAM_CHECK_CALL(libxstream_fn_output(signature, 6, m_cdata, libxstream_map_to_type(m_cdata), 1, &max_msize));
+  LIBXSTREAM_CHECK_CALL(libxstream_fn_register_signature(signature, &m_signature));
 
   return LIBXSTREAM_ERROR_NONE;
 }
@@ -196,13 +195,11 @@ int multi_dgemm_type::operator()(size_t index, size_t size)
     LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_memcpy_h2d(m_host_data->idata() + index, m_idata, sizeof(size_t) * size, m_stream));
 #if defined(LIBXSTREAM_DEBUG)
     size_t n = 0;
-    LIBXSTREAM_ASSERT(LIBXSTREAM_ERROR_NONE == libxstream_fn_nargs(m_signature, &n) && 6 == n);
+    LIBXSTREAM_ASSERT(LIBXSTREAM_ERROR_NONE == libxstream_get_arity(m_signature, &n) && 7 == n);
 #endif
     const size_t nn = i1 - m_host_data->idata()[index+size-1];
-    LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_fn_input(m_signature, 0, &size, libxstream_map_to_type(size), 0, 0));
-    LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_fn_input(m_signature, 1,   &nn, libxstream_map_to_type(nn  ), 0, 0));
-    LIBXSTREAM_ASSERT(LIBXSTREAM_ERROR_NONE == libxstream_get_arity(m_signature, &n) && 6 == n);
-    LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_fn_call(m_host_data->process(), m_signature, m_stream, LIBXSTREAM_CALL_DEFAULT));
+    const void* values[] = { &size, &nn, &m_nthreads };
+    LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_fn_call_registered(m_host_data->process(), m_signature, values, 3, m_stream, LIBXSTREAM_CALL_DEFAULT));
     LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_memcpy_d2h(m_cdata, m_host_data->cdata() + i0, sizeof(double) * (i1 - i0), m_stream));
     if (0 == demux()) {
       LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_stream_unlock(m_stream));
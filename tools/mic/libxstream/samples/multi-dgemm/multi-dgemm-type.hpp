@@ -38,7 +38,7 @@ class multi_dgemm_type {
 public:
   class host_data_type {
   public:
-    host_data_type(libxstream_function process, size_t size, const size_t split[]);
+    host_data_type(libxstream_function process, size_t size, const size_t split[], const size_t sizes[]);
     ~host_data_type();
   public:
     libxstream_function process()   { return m_process; }
@@ -65,7 +65,8 @@ private:
   int deinit();
 
 public:
-  int init(const char* name, host_data_type& host_data, int device, int demux, size_t max_batch);
+  // nthreads is the number of OpenMP threads a call may use (zero if not limited).
+  int init(const char* name, host_data_type& host_data, int device, int demux, size_t max_batch, size_t nthreads = 0);
   int operator()(size_t index, size_t size);
 
   libxstream_stream* stream() { return m_stream; }
@@ -76,12 +77,12 @@ public:
 
 private:
   host_data_type* m_host_data;
-  libxstream_argument* m_signature;
+  const libxstream_argument* m_signature; // registered
   libxstream_stream* m_stream;
   libxstream_event* m_event;
 
   double *m_adata, *m_bdata, *m_cdata;
-  size_t *m_idata, m_max_batch;
+  size_t *m_idata, m_max_batch, m_nthreads;
 };
 
 #endif // MULTI_DGEMM_TYPE_HPP
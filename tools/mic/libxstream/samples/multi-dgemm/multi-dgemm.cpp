@@ -35,6 +35,7 @@
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <chrono>
 #include <cstdio>
 #include <vector>
 #include <cmath>
@@ -46,6 +47,13 @@
 //#define MULTI_DGEMM_USE_NESTED
 #define MULTI_DGEMM_USE_SYNC 1
 #define MULTI_DGEMM_USE_CHECK
+/** Dispatches small problem sizes to specialized kernels; the value is the number of items of a size which are processed in parallel. */
+#define MULTI_DGEMM_USE_SMALL 64
+
+/** Best configuration found by the tuning mode (per distribution of matrix sizes). */
+#define MULTI_DGEMM_TUNE_FILE "multi-dgemm.cfg"
+/** GFLOPS/s of each configuration visited by the tuning mode. */
+#define MULTI_DGEMM_TUNE_CSV "multi-dgemm.csv"
 
 #define DGEMM dgemm_
 
@@ -56,140 +64,419 @@ LIBXSTREAM_EXTERN_C LIBXSTREAM_TARGET(mic) void DGEMM(
   const double*, double*, const int*);
 
 
-LIBXSTREAM_TARGET(mic) void process(LIBXSTREAM_INVAL(size_t) size, LIBXSTREAM_INVAL(size_t) nn, const size_t* idata,
-  const double* adata, const double* bdata, double* cdata)
+#if defined(MULTI_DGEMM_USE_SMALL)
+// C(MxN) += A(MxK) * B(KxN) with leading dimensions M, K, and M (column-major); the trip counts are known at compile-time
+template<int M, int N, int K>
+LIBXSTREAM_TARGET(mic) void small_dgemm(const double *LIBXSTREAM_RESTRICT a, const double *LIBXSTREAM_RESTRICT b, double *LIBXSTREAM_RESTRICT c)
+{
+  for (int j = 0; j < N; ++j) {
+    double cj[M]; // column of C kept in registers
+    for (int i = 0; i < M; ++i) cj[i] = c[j*M+i];
+    for (int k = 0; k < K; ++k) {
+      const double bkj = b[j*K+k];
+#if defined(_OPENMP)
+#     pragma omp simd
+#endif
+      for (int i = 0; i < M; ++i) cj[i] += a[k*M+i] * bkj;
+    }
+    for (int i = 0; i < M; ++i) c[j*M+i] = cj[i];
+  }
+}
+
+
+typedef void (*small_dgemm_function)(const double*, const double*, double*);
+
+// returns the specialized kernel for the (square) problem size or zero (BLAS is competitive beyond 16x16)
+LIBXSTREAM_TARGET(mic) small_dgemm_function small_dgemm_kernel(int n)
+{
+  switch (n) {
+#   define MULTI_DGEMM_SMALL(N) case N: return small_dgemm<N,N,N>
+    MULTI_DGEMM_SMALL(4);  MULTI_DGEMM_SMALL(5);  MULTI_DGEMM_SMALL(6);  MULTI_DGEMM_SMALL(8);
+    MULTI_DGEMM_SMALL(9);  MULTI_DGEMM_SMALL(12); MULTI_DGEMM_SMALL(13); MULTI_DGEMM_SMALL(16);
+#   undef MULTI_DGEMM_SMALL
+  }
+  return 0;
+}
+#endif
+
+
+LIBXSTREAM_TARGET(mic) void process(LIBXSTREAM_INVAL(size_t) size, LIBXSTREAM_INVAL(size_t) nn, LIBXSTREAM_INVAL(size_t) nthreads,
+  const size_t* idata, const double* adata, const double* bdata, double* cdata)
 {
   if (0 < LIBXSTREAM_GETVAL(size)) {
     static const double alpha = 1, beta = 1;
     static const char trans = 'N';
     const int isize = static_cast<int>(size);
     const size_t base = idata[0];
+#if defined(_OPENMP)
+    // the host threads executing the streams share the OpenMP threads (nthreads)
+    const int team = 0 < LIBXSTREAM_GETVAL(nthreads) ? static_cast<int>(LIBXSTREAM_GETVAL(nthreads)) : omp_get_max_threads();
+#else
+    LIBXSTREAM_USE_SINK(&nthreads);
+#endif
 
+    // the items are ordered by problem size (host data) i.e., a bucket is a run of equally sized items
+    // which is dispatched to a single kernel (no need to sort the items of a batch)
+    for (int begin = 0, end = 0; begin < isize; begin = end) {
+      LIBXSTREAM_ASSERT(base <= idata[begin]);
+      const size_t n2 = (begin + 1) < isize ? (idata[begin+1] - idata[begin]) : LIBXSTREAM_GETVAL(nn);
+      for (end = begin + 1; end < isize && n2 == ((end + 1) < isize ? (idata[end+1] - idata[end]) : LIBXSTREAM_GETVAL(nn)); ++end);
+      const int n = static_cast<int>(std::sqrt(static_cast<double>(n2)) + 0.5);
+#if defined(MULTI_DGEMM_USE_SMALL)
+      const small_dgemm_function kernel = small_dgemm_kernel(n);
+      if (kernel) {
+#if defined(_OPENMP)
+#       pragma omp parallel for schedule(static) num_threads(team) if(1 < team && MULTI_DGEMM_USE_SMALL <= (end - begin))
+#endif
+        for (int i = begin; i < end; ++i) {
+          const size_t offset = idata[i] - base;
+          kernel(adata + offset, bdata + offset, cdata + offset);
+        }
+        continue;
+      }
+#endif
 #if defined(_OPENMP) && defined(MULTI_DGEMM_USE_NESTED)
-    const int nthreads = omp_get_max_threads() / LIBXSTREAM_GETVAL(size);
-    const int dynamic = omp_get_dynamic(), nested = omp_get_nested();
-    omp_set_dynamic(0);
-    omp_set_nested(1);
-#   pragma omp parallel for schedule(dynamic,1) num_threads(LIBXSTREAM_GETVAL(size))
+      const int nouter = std::min(end - begin, team), ninner = std::max(team / nouter, 1);
+      const int dynamic = omp_get_dynamic(), nested = omp_get_nested();
+      omp_set_dynamic(0);
+      omp_set_nested(1);
+#     pragma omp parallel for schedule(dynamic,1) num_threads(nouter)
 #endif
-    for (int i = 0; i < isize; ++i) {
+      for (int i = begin; i < end; ++i) {
 #if defined(_OPENMP) && defined(MULTI_DGEMM_USE_NESTED)
-      omp_set_num_threads(nthreads);
+        omp_set_num_threads(ninner);
 #endif
-      LIBXSTREAM_ASSERT(base <= idata[i]);
-      const size_t i0 = idata[i], i1 = (i + 1) < isize ? idata[i+1] : (i0 + LIBXSTREAM_GETVAL(nn)), n2 = i1 - i0, offset = i0 - base;
-      const int n = static_cast<int>(std::sqrt(static_cast<double>(n2)) + 0.5);
-      DGEMM(&trans, &trans, &n, &n, &n, &alpha, adata + offset, &n, bdata + offset, &n, &beta, cdata + offset, &n);
-    }
-
+        const size_t offset = idata[i] - base;
+        DGEMM(&trans, &trans, &n, &n, &n, &alpha, adata + offset, &n, bdata + offset, &n, &beta, cdata + offset, &n);
+      }
 #if defined(_OPENMP) && defined(MULTI_DGEMM_USE_NESTED)
-    omp_set_dynamic(dynamic);
-    omp_set_nested(nested);
+      omp_set_dynamic(dynamic);
+      omp_set_nested(nested);
 #endif
+    }
   }
 }
 
 
-int main(int argc, char* argv[])
+namespace multi_dgemm_internal {
+
+struct config_type {
+  int nbatch, nstreams, demux;
+  double gflops;
+};
+
+// a configuration is only valid for the same distribution of matrix sizes and number of devices
+struct record_type {
+  int nitems;
+  unsigned long split[2], sizes[3], ndevices;
+  config_type config;
+};
+
+
+double seconds()
 {
-  try {
-    const int nitems = std::max(1 < argc ? std::atoi(argv[1]) : 60, 0);
-    const int nbatch = std::max(2 < argc ? std::atoi(argv[2]) : 10, 1);
-    const int nstreams = std::min(std::max(3 < argc ? std::atoi(argv[3]) : 2, 1), LIBXSTREAM_MAX_NSTREAMS);
-#if defined(MULTI_DGEMM_USE_SYNC)
-    const int demux = 4 < argc ? std::atoi(argv[4]) : 1;
-#else
-    const int demux = -1;
+#if defined(_OPENMP)
+  return omp_get_wtime();
+#else // wall time (not the processor time of all threads)
+  typedef std::chrono::steady_clock clock_type;
+  static const clock_type::time_point start = clock_type::now();
+  return std::chrono::duration<double>(clock_type::now() - start).count();
 #endif
-    size_t ndevices = 0;
-    if (LIBXSTREAM_ERROR_NONE != libxstream_get_ndevices(&ndevices) || 0 == ndevices) {
-      throw std::runtime_error("no device found!");
+}
+
+
+bool same_key(const record_type& a, const record_type& b)
+{
+  return a.nitems == b.nitems && a.split[0] == b.split[0] && a.split[1] == b.split[1]
+    && a.sizes[0] == b.sizes[0] && a.sizes[1] == b.sizes[1] && a.sizes[2] == b.sizes[2] && a.ndevices == b.ndevices;
+}
+
+
+void load(std::vector<record_type>& records)
+{
+  FILE *const file = fopen(MULTI_DGEMM_TUNE_FILE, "r");
+  if (file) {
+    record_type r;
+    while (11 == fscanf(file, "%i %lu %lu %lu %lu %lu %lu %i %i %i %lf", &r.nitems, r.split + 0, r.split + 1,
+      r.sizes + 0, r.sizes + 1, r.sizes + 2, &r.ndevices,
+      &r.config.nbatch, &r.config.nstreams, &r.config.demux, &r.config.gflops))
+    {
+      records.push_back(r);
     }
-#if !defined(_OPENMP)
-    fprintf(stderr, "Warning: OpenMP support needed for performance results.\n");
-#endif
+    fclose(file);
+  }
+}
 
-    fprintf(stdout, "Initializing %i device%s and host data...", static_cast<int>(ndevices), 1 == ndevices ? "" : "s");
-    const size_t split[] = { size_t(nitems * 18.0 / 250.0 + 0.5), size_t(nitems * 74.0 / 250.0 + 0.5) };
-    multi_dgemm_type::host_data_type host_data(reinterpret_cast<libxstream_function>(&process), nitems, split);
-    fprintf(stdout, " %.1f MB\n", host_data.bytes() * 1E-6);
 
-    fprintf(stdout, "Initializing %i stream%s per device...", nstreams, 1 < nstreams ? "s" : "");
-    const size_t nstreams_total = ndevices * nstreams;
-    multi_dgemm_type multi_dgemm[LIBXSTREAM_MAX_NSTREAMS];
-    for (size_t i = 0; i < nstreams_total; ++i) {
-      char name[128];
-      LIBXSTREAM_SNPRINTF(name, sizeof(name), "Stream %i", static_cast<int>(i + 1));
-      LIBXSTREAM_CHECK_CALL_THROW(multi_dgemm[i].init(name, host_data, static_cast<int>(i % ndevices), demux, static_cast<size_t>(nbatch)));
+bool store(const record_type& record)
+{
+  std::vector<record_type> records;
+  load(records);
+  std::vector<record_type>::iterator i = records.begin();
+  for (; i != records.end() && !same_key(*i, record); ++i);
+  if (i != records.end()) *i = record; else records.push_back(record);
+
+  FILE *const file = fopen(MULTI_DGEMM_TUNE_FILE, "w");
+  if (file) {
+    for (i = records.begin(); i != records.end(); ++i) {
+      fprintf(file, "%i %lu %lu %lu %lu %lu %lu %i %i %i %.1f\n", i->nitems, i->split[0], i->split[1],
+        i->sizes[0], i->sizes[1], i->sizes[2], i->ndevices,
+        i->config.nbatch, i->config.nstreams, i->config.demux, i->config.gflops);
     }
+    fclose(file);
+  }
+  return 0 != file;
+}
+
+
+// returns the duration (seconds) of processing all items excluding the initialization of the streams
+double run(multi_dgemm_type::host_data_type& host_data, size_t ndevices, const config_type& config, bool verbose)
+{
+  const int nitems = static_cast<int>(host_data.size()), nbatch = config.nbatch, nstreams = config.nstreams;
+  const size_t nstreams_total = ndevices * nstreams;
+  LIBXSTREAM_ASSERT(nstreams_total <= LIBXSTREAM_MAX_NSTREAMS);
+
+  if (verbose) {
+    fprintf(stdout, "Initializing %i stream%s per device...", nstreams, 1 < nstreams ? "s" : "");
+  }
+#if defined(_OPENMP) && !defined(LIBXSTREAM_OFFLOAD)
+  // streams are executed concurrently by host threads which share the OpenMP threads
+  const size_t nthreads = std::max<size_t>(omp_get_max_threads() / nstreams_total, 1);
+#else
+  const size_t nthreads = 0; // not limited
+#endif
+  multi_dgemm_type multi_dgemm[LIBXSTREAM_MAX_NSTREAMS];
+  for (size_t i = 0; i < nstreams_total; ++i) {
+    char name[128];
+    LIBXSTREAM_SNPRINTF(name, sizeof(name), "Stream %i", static_cast<int>(i + 1));
+    LIBXSTREAM_CHECK_CALL_THROW(multi_dgemm[i].init(name, host_data, static_cast<int>(i % ndevices), config.demux, static_cast<size_t>(nbatch), nthreads));
+  }
+  if (verbose) {
     if (0 < nstreams_total) {
       fprintf(stdout, " %.1f MB\n", nstreams * multi_dgemm[0].bytes() * 1E-6);
     }
-
     const int nbatches = (nitems + nbatch - 1) / nbatch;
     fprintf(stdout, "Running %i batch%s of %i item%s...\n", nbatches,
       1 < nbatches ? "es" : "", std::min(nbatch, nitems),
       1 < nbatch ? "s" : "");
+  }
 
 #if defined(_OPENMP)
 # if !defined(LIBXSTREAM_OFFLOAD)
-    omp_set_dynamic(0);
-    omp_set_nested(0);
+  omp_set_dynamic(0);
+  omp_set_nested(0);
 # endif
-    const double start = omp_get_wtime();
-#   pragma omp parallel for schedule(dynamic)
 #endif
-    for (int i = 0; i < nitems; i += nbatch) {
-      const size_t j = i / nbatch, n = j % nstreams_total;
-      multi_dgemm_type& call = multi_dgemm[n];
-      LIBXSTREAM_CHECK_CALL_ASSERT(call(i, std::min(nbatch, nitems - i)));
+  const double start = seconds();
+#if defined(_OPENMP)
+# pragma omp parallel for schedule(dynamic)
+#endif
+  for (int i = 0; i < nitems; i += nbatch) {
+    const size_t j = i / nbatch, n = j % nstreams_total;
+    multi_dgemm_type& call = multi_dgemm[n];
+    LIBXSTREAM_CHECK_CALL_ASSERT(call(i, std::min(nbatch, nitems - i)));
 #if defined(MULTI_DGEMM_USE_SYNC) && (1 <= MULTI_DGEMM_USE_SYNC)
-      LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_event_record(call.event(), call.stream()));
+    LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_event_record(call.event(), call.stream()));
 #endif
-      // synchronize every Nth iteration with N being the total number of streams
-      if (n == (nstreams_total - 1)) {
-        for (size_t k = 0; k < nstreams_total; ++k) {
+    // synchronize every Nth iteration with N being the total number of streams
+    if (n == (nstreams_total - 1)) {
+      for (size_t k = 0; k < nstreams_total; ++k) {
 #if defined(MULTI_DGEMM_USE_SYNC)
 # if (2 <= (MULTI_DGEMM_USE_SYNC))
-          // wait for an event within a stream
-          LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_stream_wait_event(multi_dgemm[0].stream(), multi_dgemm[k].event()));
+        // wait for an event within a stream
+        LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_stream_wait_event(multi_dgemm[0].stream(), multi_dgemm[k].event()));
 # elif (1 <= (MULTI_DGEMM_USE_SYNC))
-          // wait for an event on the host
-          LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_event_synchronize(multi_dgemm[k].event()));
+        // wait for an event on the host
+        LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_event_synchronize(multi_dgemm[k].event()));
 # else
-          // wait for all work in a stream
-          LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_stream_sync(multi_dgemm[k].stream()));
+        // wait for all work in a stream
+        LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_stream_sync(multi_dgemm[k].stream()));
 # endif
 #endif
-        }
       }
     }
+  }
+
+  // sync all streams to complete any pending work
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(0));
+  return seconds() - start;
+}
 
-    // sync all streams to complete any pending work
-    LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(0));
 
-#if defined(_OPENMP)
-    const double duration = omp_get_wtime() - start;
+// hill climbing over the batch size, the number of streams, and the demux-mode starting at the given configuration;
+// each configuration is measured once and the visited configurations (GFLOPS/s surface) are written as CSV
+config_type tune(multi_dgemm_type::host_data_type& host_data, size_t ndevices, const config_type& initial, int max_nstreams)
+{
+  const int nitems = static_cast<int>(host_data.size());
+  size_t allocatable = 0;
+  libxstream_mem_info(0, &allocatable, 0);
+  // device buffers of a stream: A, B, and C of the largest matrix per item of a batch
+  const size_t item_bytes = 3 * sizeof(double) * host_data.max_matrix_size() + sizeof(size_t);
+
+  FILE *const csv = fopen(MULTI_DGEMM_TUNE_CSV, "w");
+  if (csv) fprintf(csv, "nbatch;nstreams;demux;gflops\n");
+  fprintf(stdout, "Tuning (%s)...\nnbatch;nstreams;demux;gflops\n", MULTI_DGEMM_TUNE_CSV);
+
+  std::vector<config_type> visited;
+  config_type best = initial;
+  best.gflops = -1;
+  for (config_type current = initial;;) {
+    config_type candidates[] = { // current configuration and its neighbors
+      current, current, current, current, current, current, current
+    };
+    candidates[1].nbatch *= 2; candidates[2].nbatch /= 2;
+    candidates[3].nstreams *= 2; candidates[4].nstreams /= 2;
+#if defined(MULTI_DGEMM_USE_SYNC)
+    candidates[5].demux = -1 == current.demux ? 0 : -1;
+    candidates[6].demux = 1 == current.demux ? 0 : 1;
+#endif
+    for (size_t i = 0; i < sizeof(candidates) / sizeof(*candidates); ++i) {
+      config_type& c = candidates[i];
+      bool skip = c.nbatch < 1 || nitems < c.nbatch || c.nstreams < 1 || max_nstreams < c.nstreams
+        || (0 < allocatable && allocatable < 2 * ndevices * c.nstreams * c.nbatch * item_bytes);
+      for (std::vector<config_type>::const_iterator v = visited.begin(); !skip && v != visited.end(); ++v) {
+        skip = v->nbatch == c.nbatch && v->nstreams == c.nstreams && v->demux == c.demux;
+      }
+      if (!skip) {
+        c.gflops = host_data.flops() * 1E-9 / run(host_data, ndevices, c, false);
+        visited.push_back(c);
+        fprintf(stdout, "%i;%i;%i;%.1f\n", c.nbatch, c.nstreams, c.demux, c.gflops);
+        if (csv) fprintf(csv, "%i;%i;%i;%.1f\n", c.nbatch, c.nstreams, c.demux, c.gflops);
+        if (best.gflops < c.gflops) best = c;
+      }
+    }
+    if (best.nbatch == current.nbatch && best.nstreams == current.nstreams && best.demux == current.demux) {
+      break; // no neighbor improves
+    }
+    current = best;
+  }
+
+  if (csv) fclose(csv);
+  return best;
+}
+
+
+// processes each bucket of equally sized items (host) such that the performance is known per problem size
+void report(const multi_dgemm_type::host_data_type& host_data)
+{
+  const size_t size = host_data.size(), *const idata = host_data.idata();
+  for (size_t begin = 0, end = 0; begin < size; begin = end) {
+    const size_t nn = idata[begin+1] - idata[begin], flops = nn * (2 * static_cast<size_t>(std::sqrt(static_cast<double>(nn)) + 0.5) + 1);
+    for (end = begin + 1; end < size && nn == (idata[end+1] - idata[end]); ++end);
+    const size_t nitems = end - begin, i0 = idata[begin], nthreads = 0; // not limited (no streams)
+    std::vector<double> cdata(idata[end] - i0, 0.0);
+    int nrepeat = 0;
+    const double start = seconds();
+    double duration = 0;
+    do { // repeat short buckets to obtain a reliable measurement
+      process(LIBXSTREAM_SETVAL(nitems), LIBXSTREAM_SETVAL(nn), LIBXSTREAM_SETVAL(nthreads), idata + begin, host_data.adata() + i0, host_data.bdata() + i0, &cdata[0]);
+      duration = seconds() - start;
+      ++nrepeat;
+    }
+    while (0.1 > duration);
+    const int n = static_cast<int>(std::sqrt(static_cast<double>(nn)) + 0.5);
+#if defined(MULTI_DGEMM_USE_SMALL)
+    const char *const kernel = small_dgemm_kernel(n) ? "specialized" : "BLAS";
+#else
+    const char *const kernel = "BLAS";
+#endif
+    fprintf(stdout, "Bucket %ix%i:\t%.1f GFLOPS/s (%lu item%s, %s)\n", n, n, nrepeat * nitems * flops * 1E-9 / duration,
+      static_cast<unsigned long>(nitems), 1 < nitems ? "s" : "", kernel);
+  }
+}
+
+} // namespace multi_dgemm_internal
+
+
+int main(int argc, char* argv[])
+{
+  try {
+    // "tune" as first argument searches the best configuration for the given number of items
+    const bool tune = 1 < argc && 0 == strcmp("tune", argv[1]);
+    const int offset = tune ? 1 : 0;
+    const int nitems = std::max((1 + offset) < argc ? std::atoi(argv[1+offset]) : 60, 0);
+    size_t ndevices = 0;
+    if (LIBXSTREAM_ERROR_NONE != libxstream_get_ndevices(&ndevices) || 0 == ndevices) {
+      throw std::runtime_error("no device found!");
+    }
+    const int max_nstreams = std::max(LIBXSTREAM_MAX_NSTREAMS / static_cast<int>(ndevices), 1);
+    multi_dgemm_internal::config_type config = { 10, 2, 1, 0 };
+    if (!tune) { // the tuning starts at the default configuration
+      config.nbatch = std::max(2 < argc ? std::atoi(argv[2]) : config.nbatch, 1);
+      config.nstreams = std::min(std::max(3 < argc ? std::atoi(argv[3]) : config.nstreams, 1), max_nstreams);
+#if defined(MULTI_DGEMM_USE_SYNC)
+      config.demux = 4 < argc ? std::atoi(argv[4]) : config.demux;
+#endif
+    }
+#if !defined(MULTI_DGEMM_USE_SYNC)
+    config.demux = -1;
+#endif
+#if !defined(_OPENMP)
+    fprintf(stderr, "Warning: OpenMP support needed for performance results.\n");
+#endif
+
+    fprintf(stdout, "Initializing %i device%s and host data...", static_cast<int>(ndevices), 1 == ndevices ? "" : "s");
+    const size_t split[] = { size_t(nitems * 18.0 / 250.0 + 0.5), size_t(nitems * 74.0 / 250.0 + 0.5) };
+    // problem sizes of the mix (e.g., MULTI_DGEMM_SIZES=13,23,32 for small matrices)
+    unsigned long sizes[] = { 100, 600, 1000 };
+    const char *const env_sizes = getenv("MULTI_DGEMM_SIZES");
+    if (env_sizes && (3 != sscanf(env_sizes, "%lu,%lu,%lu", sizes + 0, sizes + 1, sizes + 2) || 0 == sizes[0] || 0 == sizes[1] || 0 == sizes[2])) {
+      throw std::runtime_error("MULTI_DGEMM_SIZES must be three comma-separated sizes!");
+    }
+    const size_t msizes[] = { sizes[0], sizes[1], sizes[2] };
+    multi_dgemm_type::host_data_type host_data(reinterpret_cast<libxstream_function>(&process), nitems, split, msizes);
+    fprintf(stdout, " %.1f MB\n", host_data.bytes() * 1E-6);
+
+    multi_dgemm_internal::record_type record = { nitems, { split[0], split[1] },
+      { sizes[0], sizes[1], sizes[2] }, static_cast<unsigned long>(ndevices), config };
+    if (tune) {
+      const int limit = 3 < argc ? std::atoi(argv[3]) : max_nstreams; // "tune <nitems> <max-nstreams>"
+      record.config = multi_dgemm_internal::tune(host_data, ndevices, config, std::min(std::max(limit, 1), max_nstreams));
+      config = record.config;
+      if (multi_dgemm_internal::store(record)) {
+        fprintf(stdout, "Tuned: nbatch=%i nstreams=%i demux=%i (%s)\n", config.nbatch, config.nstreams, config.demux, MULTI_DGEMM_TUNE_FILE);
+      }
+      // the tuning runs accumulated into C
+      std::fill_n(host_data.cdata(), host_data.idata()[nitems], 0.0);
+    }
+    else if (2 >= argc) { // no explicit configuration given
+      std::vector<multi_dgemm_internal::record_type> records;
+      multi_dgemm_internal::load(records);
+      for (std::vector<multi_dgemm_internal::record_type>::const_iterator i = records.begin(); i != records.end(); ++i) {
+        if (multi_dgemm_internal::same_key(*i, record) && max_nstreams >= i->config.nstreams) {
+          config = i->config;
+          fprintf(stdout, "Tuned configuration: nbatch=%i nstreams=%i demux=%i (%s)\n", config.nbatch, config.nstreams, config.demux, MULTI_DGEMM_TUNE_FILE);
+          break;
+        }
+      }
+    }
+
+    const double duration = multi_dgemm_internal::run(host_data, ndevices, config, true);
     fprintf(stdout, "Performance: %.1f GFLOPS/s (%s)\n", host_data.flops() * 1E-9 / duration,
-      0 == demux ? "manual locking" : (0 < demux ? "synchronization" : "automatic locking"));
+      0 == config.demux ? "manual locking" : (0 < config.demux ? "synchronization" : "automatic locking"));
     fprintf(stdout, "Duration: %.1f s\n", duration);
-#endif
+    libxstream_wait_stats wait_stats;
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_get_wait_stats(&wait_stats));
+    fprintf(stdout, "Waiting: %.0f%% spinning, %.1f us wake-up latency (max. %.1f us)\n", wait_stats.idle_cpu,
+      wait_stats.wakeup_latency * 1E6, wait_stats.wakeup_latency_max * 1E6);
 
 #if defined(MULTI_DGEMM_USE_CHECK)
+    // reference is calling BLAS directly (process may dispatch to specialized kernels)
     std::vector<double> expected(host_data.max_matrix_size());
-    const size_t testbatchsize = 1;
+    static const double alpha = 1, beta = 0;
+    static const char trans = 'N';
     double max_error = 0;
     size_t i0 = 0;
     for (int i = 0; i < nitems; ++i) {
       const size_t i1 = host_data.idata()[i+1];
-      const int nn = static_cast<int>(i1 - i0);
-      std::fill_n(&expected[0], nn, 0.0);
-      process(LIBXSTREAM_SETVAL(testbatchsize), LIBXSTREAM_SETVAL(nn), host_data.idata() + i, host_data.adata() + i0, host_data.bdata() + i0, &expected[0]);
+      const int nn = static_cast<int>(i1 - i0), m = static_cast<int>(std::sqrt(static_cast<double>(nn)) + 0.5);
+      DGEMM(&trans, &trans, &m, &m, &m, &alpha, host_data.adata() + i0, &m, host_data.bdata() + i0, &m, &beta, &expected[0], &m);
       for (int n = 0; n < nn; ++n) max_error = std::max(max_error, std::abs(expected[n] - host_data.cdata()[i0+n]));
       i0 = i1;
     }
     fprintf(stdout, "Error: %g\n", max_error);
 #endif
+    multi_dgemm_internal::report(host_data);
     fprintf(stdout, "Finished\n");
   }
   catch(const std::exception& e) {
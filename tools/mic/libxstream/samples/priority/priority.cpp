@@ -0,0 +1,140 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#include "../../include/libxstream.h"
+#include "../../include/libxstream_begin.h"
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include "../../include/libxstream_end.h"
+
+
+namespace priority_internal {
+
+double seconds()
+{
+  typedef std::chrono::steady_clock clock_type;
+  static const clock_type::time_point start = clock_type::now();
+  return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+
+/**
+ * Measures the latency of small work items enqueued into a stream of the given priority
+ * while other streams (least priority) are kept busy with bulk work. The maximum latency
+ * is written into the given variable, and the average latency is returned (seconds).
+ */
+double latency(int device, int priority, int nbulk, size_t bulk_size, int nsamples, double& max_latency)
+{
+  std::vector<libxstream_stream*> bulk(nbulk, static_cast<libxstream_stream*>(0));
+  std::vector<void*> bulk_mem(nbulk, static_cast<void*>(0));
+  libxstream_stream* stream = 0;
+  void* mem = 0;
+  int least = 0, greatest = 0;
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_priority_range(&least, &greatest));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_create(&stream, device, 0, priority, "latency"));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_allocate(device, &mem, 8, 0));
+  for (int i = 0; i < nbulk; ++i) {
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_create(&bulk[i], device, 0, least, "bulk"));
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_allocate(device, &bulk_mem[i], bulk_size, 0));
+  }
+
+  double sum = 0;
+  max_latency = 0;
+  for (int s = 0; s < nsamples; ++s) {
+    // keep the bulk streams busy
+    for (int i = 0; i < nbulk; ++i) {
+      for (int j = 0; j < 4; ++j) {
+        LIBXSTREAM_CHECK_CALL_THROW(libxstream_memset_zero(bulk_mem[i], bulk_size, bulk[i]));
+      }
+    }
+    const double start = seconds();
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_memset_zero(mem, 8, stream));
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(stream));
+    const double duration = seconds() - start;
+    max_latency = std::max(max_latency, duration);
+    sum += duration;
+  }
+
+  for (int i = 0; i < nbulk; ++i) {
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(bulk[i]));
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_deallocate(device, bulk_mem[i]));
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_destroy(bulk[i]));
+  }
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_deallocate(device, mem));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_destroy(stream));
+  return sum / std::max(nsamples, 1);
+}
+
+} // namespace priority_internal
+
+
+int main(int argc, char* argv[])
+{
+  try {
+    const int nbulk = std::max(1 < argc ? std::atoi(argv[1]) : static_cast<int>(2 * std::thread::hardware_concurrency()), 1);
+    const size_t bulk_size = static_cast<size_t>(std::max(2 < argc ? std::atoi(argv[2]) : 512, 1)) << 10;
+    const int nsamples = std::max(3 < argc ? std::atoi(argv[3]) : 64, 1);
+
+    size_t ndevices = 0;
+    if (LIBXSTREAM_ERROR_NONE != libxstream_get_ndevices(&ndevices) || 0 == ndevices) {
+      throw std::runtime_error("no device found!");
+    }
+
+    int least = 0, greatest = 0;
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_priority_range(&least, &greatest));
+    fprintf(stdout, "Bulk streams: %i (%lu KB per item), priorities: %i (least) to %i (greatest)\n",
+      nbulk, static_cast<unsigned long>(bulk_size >> 10), least, greatest);
+
+    const int priorities[] = { least, greatest };
+    for (size_t i = 0; i < sizeof(priorities) / sizeof(*priorities); ++i) {
+      double max_latency = 0;
+      const double avg_latency = priority_internal::latency(0, priorities[i], nbulk, bulk_size, nsamples, max_latency);
+      fprintf(stdout, "Priority %i: latency %.3f ms (average), %.3f ms (maximum)\n",
+        priorities[i], 1E3 * avg_latency, 1E3 * max_latency);
+    }
+
+    fprintf(stdout, "Finished\n");
+  }
+  catch(const std::exception& e) {
+    fprintf(stderr, "Error: %s\n", e.what());
+    return EXIT_FAILURE;
+  }
+  catch(...) {
+    fprintf(stderr, "Error: unknown exception caught!\n");
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -33,12 +33,15 @@
 #include <stdexcept>
 #include <algorithm>
 #include <complex>
+#include <vector>
 #include <cstdlib>
 #include <cstring>
 #include <cassert>
 #include <cstdio>
 #if defined(_OPENMP)
 # include <omp.h>
+#else
+# include <ctime>
 #endif
 #include "../../include/libxstream_end.h"
 
@@ -98,6 +101,55 @@ LIBXSTREAM_TARGET(mic) void complex_cpp(libxstream_bool& ok,
   ok = result ? LIBXSTREAM_TRUE : LIBXSTREAM_FALSE;
 }
 
+
+// more arguments than the enqueued work holds inline (LIBXSTREAM_CAPTURE_NARGS) and a six-dimensional array
+LIBXSTREAM_TARGET(mic) void many(int* result, const char* array,
+  const int* a1, const int* a2, const int* a3, const int* a4, const int* a5, const int* a6, const int* a7, const int* a8, const int* a9, const int* a10, const int* a11, const int* a12, const int* a13, const int* a14, const int* a15, const int* a16, const int* a17, const int* a18, const int* a19)
+{
+  size_t dims = 0, shape[LIBXSTREAM_MAX_NDIMS], arity = 0;
+  const bool ok = LIBXSTREAM_ERROR_NONE == libxstream_get_arity(0, &arity) && 21 == arity
+    && LIBXSTREAM_ERROR_NONE == libxstream_get_dims(0, 1, &dims) && 6 == dims
+    && LIBXSTREAM_ERROR_NONE == libxstream_get_shape(0, 1, shape) && 7 == shape[5] && 0 != array;
+  *result = ok ? (*a1 + *a2 + *a3 + *a4 + *a5 + *a6 + *a7 + *a8 + *a9 + *a10 + *a11 + *a12 + *a13 + *a14 + *a15 + *a16 + *a17 + *a18 + *a19) : -1;
+}
+
+// stream and event callbacks (libxstream_stream_add_callback, libxstream_event_add_callback)
+void signal(void* counter)
+{
+  ++*static_cast<volatile int*>(counter);
+}
+
+double seconds()
+{
+#if defined(_OPENMP)
+  return omp_get_wtime();
+#else
+  return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+
+// measures the rate of enqueuing small work items (enqueues per second)
+double enqueue(int device, int nenqueues)
+{
+  const size_t size = 8;
+  libxstream_stream* stream = 0;
+  void* buffer = 0;
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_create(&stream, device, 0, 0, 0));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_allocate(device, &buffer, size, 0));
+
+  const double start = seconds();
+  for (int i = 0; i < nenqueues; ++i) {
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_memset_zero(buffer, size, stream));
+  }
+  const double duration = seconds() - start;
+
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(stream));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_deallocate(device, buffer));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_destroy(stream));
+  return nenqueues / std::max(duration, 1E-9);
+}
+
 } // namespace test_internal
 
 /* workaround for issue "cannot find address of function"; compile using "make.sh -g" */
@@ -218,6 +270,43 @@ test_type::test_type(int device)
   LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(m_stream));
   LIBXSTREAM_CHECK_CONDITION_THROW(LIBXSTREAM_FALSE != ok);
 
+  // registered signature: only the replaced arguments are copied per call
+  const libxstream_argument* handle = 0;
+  const float freal = 2.f * c32.real();
+  const void* values[] = { 0, 0, &freal };
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_fn_register_signature(signature, &handle));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_fn_call_registered(complex_c, handle, 0, 0, m_stream, LIBXSTREAM_CALL_DEFAULT));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(m_stream));
+  LIBXSTREAM_CHECK_CONDITION_THROW(LIBXSTREAM_FALSE != ok);
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_fn_call_registered(complex_c, handle, values, 3, m_stream, LIBXSTREAM_CALL_DEFAULT));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(m_stream));
+  LIBXSTREAM_CHECK_CONDITION_THROW(LIBXSTREAM_FALSE == ok);
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_fn_unregister_signature(handle));
+  // unregistering does not wait for the calls (the enqueued calls keep the registered signature)
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_fn_register_signature(signature, &handle));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_fn_call_registered(complex_c, handle, 0, 0, m_stream, LIBXSTREAM_CALL_DEFAULT));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_fn_unregister_signature(handle));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(m_stream));
+  LIBXSTREAM_CHECK_CONDITION_THROW(LIBXSTREAM_FALSE != ok);
+
+#if (20 < (LIBXSTREAM_MAX_NARGS)) && (5 < (LIBXSTREAM_MAX_NDIMS))
+  int many = 0, scalars[19];
+  const size_t shape[] = { 2, 1, 1, 1, 1, 7 };
+  const std::vector<char> array(2 * 7, 0);
+  libxstream_argument* args = 0;
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_fn_create_signature(&args, 21));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_fn_output(args, 0, &many, libxstream_map_to_type(many), 0, 0));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_fn_input (args, 1, &array[0], libxstream_map_to_type(array[0]), 6, shape));
+  for (int i = 0; i < 19; ++i) {
+    scalars[i] = i + 1;
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_fn_input(args, i + 2, scalars + i, libxstream_map_to_type(scalars[i]), 0, 0));
+  }
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_fn_call(reinterpret_cast<libxstream_function>(test_internal::many), args, m_stream, LIBXSTREAM_CALL_DEFAULT));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(m_stream));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_fn_destroy_signature(args));
+  LIBXSTREAM_CHECK_CONDITION_THROW(19 * 20 / 2 == many);
+#endif
+
   std::fill_n(reinterpret_cast<char*>(m_host_mem), size, pattern_b);
   LIBXSTREAM_CHECK_CALL_THROW(libxstream_memcpy_d2h(m_dev_mem2, m_host_mem, size, m_stream));
 
@@ -246,6 +335,45 @@ test_type::test_type(int device)
   const char zero = 0;
   test_internal::check(ok, LIBXSTREAM_SETVAL(zero), m_host_mem, LIBXSTREAM_SETVAL(size));
   LIBXSTREAM_CHECK_CONDITION_THROW(LIBXSTREAM_FALSE != ok);
+
+  // batched transfers: the first half of the blocks is contiguous (merged), the second half is reversed
+  const size_t nblocks = 64, block = size / nblocks;
+  libxstream_memcpy_desc batch[nblocks];
+  for (size_t i = 0; i < nblocks; ++i) {
+    const size_t offset = (i < nblocks / 2 ? i : (nblocks + nblocks / 2 - 1 - i)) * block;
+    batch[i].src = reinterpret_cast<const char*>(m_host_mem) + offset;
+    batch[i].dst = reinterpret_cast<char*>(m_dev_mem1) + offset;
+    batch[i].size = block;
+  }
+  std::fill_n(reinterpret_cast<char*>(m_host_mem), size, pattern_a);
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_memcpy_h2d_batch(batch, nblocks, m_stream));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(m_stream));
+  for (size_t i = 0; i < nblocks; ++i) {
+    void *const host = const_cast<void*>(batch[i].src);
+    batch[i].src = batch[i].dst;
+    batch[i].dst = host;
+  }
+  std::fill_n(reinterpret_cast<char*>(m_host_mem), size, pattern_b);
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_memcpy_d2h_batch(batch, nblocks, m_stream));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(m_stream));
+  test_internal::check(ok, LIBXSTREAM_SETVAL(pattern_a), m_host_mem, LIBXSTREAM_SETVAL(nblocks * block));
+  LIBXSTREAM_CHECK_CONDITION_THROW(LIBXSTREAM_FALSE != ok);
+
+  // pack a sub-block of a (host) matrix into a (device) buffer, and unpack it into another location
+  const size_t pitch[] = { 97, 101 }, extent[] = { 13, 17 }, packed[] = { 13, 17 };
+  const int offset[] = { 5, 7 }, moved[] = { 80, 3 }, origin[] = { 0, 0 };
+  LIBXSTREAM_CHECK_CONDITION_THROW(pitch[0] * pitch[1] * sizeof(int) <= size);
+  int *const matrix = static_cast<int*>(m_host_mem);
+  for (size_t i = 0; i < pitch[0] * pitch[1]; ++i) matrix[i] = static_cast<int>(i);
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_memcpy_2d(matrix, m_dev_mem1, sizeof(int), extent, offset, pitch, origin, packed, LIBXSTREAM_MEMCPY_H2D, m_stream));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_memcpy_2d(m_dev_mem1, matrix, sizeof(int), extent, origin, packed, moved, pitch, LIBXSTREAM_MEMCPY_D2H, m_stream));
+  LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(m_stream));
+  for (size_t j = 0; j < extent[1]; ++j) {
+    for (size_t i = 0; i < extent[0]; ++i) {
+      const size_t a = (offset[1] + j) * pitch[0] + offset[0] + i, b = (moved[1] + j) * pitch[0] + moved[0] + i;
+      LIBXSTREAM_CHECK_CONDITION_THROW(static_cast<int>(a) == matrix[b]);
+    }
+  }
 }
 
 
@@ -285,6 +413,210 @@ int main(int argc, char* argv[])
     for (int i = 0; i < ntasks; ++i) {
       const test_type test(i % ndevices);
     }
+
+    // deallocated buffers are cached and reused (unless the high-water mark is zero)
+    libxstream_mem_stats stats;
+    LIBXSTREAM_CHECK_CALL_THROW(libxstream_get_mem_stats(-1, &stats));
+    if (0 < stats.limit) {
+      void *buffer = 0, *reused = 0;
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_allocate(-1, &buffer, 4711, 0));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_deallocate(-1, buffer));
+      const size_t hits = stats.hits;
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_allocate(-1, &reused, 4711, 0));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_get_mem_stats(-1, &stats));
+      LIBXSTREAM_CHECK_CONDITION_THROW(buffer == reused && hits < stats.hits);
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_deallocate(-1, reused));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_trim(-1, 0));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_get_mem_stats(-1, &stats));
+      LIBXSTREAM_CHECK_CONDITION_THROW(0 == stats.cached && 0 == stats.nbuffers);
+    }
+
+    // the number of streams is not limited at compile-time; an event recorded for all streams
+    // orders another stream after all of them (cross-stream dependencies)
+    {
+      std::vector<libxstream_stream*> streams(4 * LIBXSTREAM_MAX_NSTREAMS + 1, static_cast<libxstream_stream*>(0));
+      std::vector<char> values(streams.size(), 1);
+      libxstream_stream* dependent = 0;
+      libxstream_event* event = 0;
+      void* buffer = 0;
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_create(&dependent, 0, 0, 0, "dependent"));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_allocate(0, &buffer, streams.size(), 0));
+      for (size_t i = 0; i < streams.size(); ++i) {
+        LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_create(&streams[i], 0, 0, 0, 0));
+        LIBXSTREAM_CHECK_CALL_THROW(libxstream_memset_zero(static_cast<char*>(buffer) + i, 1, streams[i]));
+      }
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_event_create(&event));
+      volatile int nevent = 0, nstream = 0;
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_event_record(event, 0));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_event_add_callback(event, test_internal::signal, const_cast<int*>(&nevent)));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_wait_event(dependent, event));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_memcpy_d2h(buffer, &values[0], values.size(), dependent));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_add_callback(dependent, test_internal::signal, const_cast<int*>(&nstream)));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(dependent));
+      LIBXSTREAM_CHECK_CONDITION_THROW(std::vector<char>(values.size(), 0) == values && 1 == nstream);
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_event_synchronize(event));
+      // the event callback is called by the thread completing the recorded work (shortly after)
+      for (const double start = test_internal::seconds(); 0 == nevent && 10 > (test_internal::seconds() - start);) {}
+      LIBXSTREAM_CHECK_CONDITION_THROW(1 == nevent);
+      // called right away since the recorded work is completed already
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_event_add_callback(event, test_internal::signal, const_cast<int*>(&nevent)));
+      LIBXSTREAM_CHECK_CONDITION_THROW(2 == nevent);
+      // called once all streams executed the work enqueued so far
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_add_callback(0, test_internal::signal, const_cast<int*>(&nevent)));
+      for (const double start = test_internal::seconds(); 2 == nevent && 10 > (test_internal::seconds() - start);) {}
+      LIBXSTREAM_CHECK_CONDITION_THROW(3 == nevent);
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_event_destroy(event));
+      for (size_t i = 0; i < streams.size(); i += 2) { // unregister in between
+        LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_destroy(streams[i]));
+      }
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(0));
+      for (size_t i = 1; i < streams.size(); i += 2) {
+        LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_destroy(streams[i]));
+      }
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_deallocate(0, buffer));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_destroy(dependent));
+    }
+
+    // more streams than host threads, each receiving more work than executed at once (LIBXSTREAM_ASYNCHOST_BATCH)
+    // from concurrently enqueuing threads; synchronizing all streams must not hang
+    for (int nstreams = 1; nstreams <= 32; nstreams *= 2) {
+      std::vector<libxstream_stream*> streams(nstreams, static_cast<libxstream_stream*>(0));
+      const int nitems = 4 * (LIBXSTREAM_MAX_QSIZE);
+      void* buffer = 0;
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_allocate(0, &buffer, streams.size(), 0));
+      for (size_t i = 0; i < streams.size(); ++i) {
+        LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_create(&streams[i], 0, 0, 0, 0));
+      }
+#if defined(_OPENMP)
+#     pragma omp parallel for num_threads(nstreams) schedule(static,1)
+#endif
+      for (int i = 0; i < nstreams; ++i) {
+        for (int j = 0; j < nitems; ++j) {
+          LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_memset_zero(static_cast<char*>(buffer) + i, 1, streams[i]));
+        }
+      }
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(0));
+      for (size_t i = 0; i < streams.size(); ++i) {
+        LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_destroy(streams[i]));
+      }
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_deallocate(0, buffer));
+    }
+
+    // recorded work (graph) is launched many times; pointer arguments can be updated
+    {
+      const size_t size = 4096, extent[] = { 13, 17 }, pitch[] = { 64, 64 };
+      const int offset[] = { 3, 5 }, origin[] = { 0, 0 };
+      std::vector<char> a(size, 'a'), b(size, 'b'), c(size, 0);
+      libxstream_stream* stream = 0;
+      libxstream_event* event = 0;
+      libxstream_graph* graph = 0;
+      void *dev = 0, *block = 0;
+      size_t nupdated = 0;
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_create(&stream, 0, 0, 0, "graph"));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_event_create(&event));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_allocate(0, &dev, size, 0));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_allocate(0, &block, extent[0] * extent[1], 0));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_graph_begin(stream));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_memcpy_h2d(&a[0], dev, size, stream));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_event_record(event, stream));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_wait_event(stream, event));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_memcpy_d2h(dev, &c[0], size, stream));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_memcpy_2d(dev, block, 1, extent, offset, pitch, origin, extent, LIBXSTREAM_MEMCPY_D2D, stream));
+      LIBXSTREAM_CHECK_CONDITION_THROW(LIBXSTREAM_ERROR_NONE != libxstream_stream_sync(stream)); // cannot wait while recording
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_graph_end(stream, &graph));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(stream));
+      LIBXSTREAM_CHECK_CONDITION_THROW(0 == c[0] && 0 == c[size-1]); // nothing executed yet
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_graph_launch(graph));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(stream));
+      LIBXSTREAM_CHECK_CONDITION_THROW(a == c);
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_graph_update(graph, &a[0], &b[0], &nupdated));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_graph_launch(graph));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_event_synchronize(event));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(stream));
+      LIBXSTREAM_CHECK_CONDITION_THROW(1 == nupdated && b == c);
+      // recorded transfers are counted each time the graph is launched
+      libxstream_stream_counters counters;
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_stats(stream, &counters));
+      LIBXSTREAM_CHECK_CONDITION_THROW(counters.nenqueued == counters.ncompleted && 0 < counters.queue_depth_max);
+      LIBXSTREAM_CHECK_CONDITION_THROW(2 * size == counters.h2d && 2 * size == counters.d2h && 2 * extent[0] * extent[1] == counters.d2d);
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_graph_destroy(graph));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_deallocate(0, block));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_deallocate(0, dev));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_event_destroy(event));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_destroy(stream));
+    }
+
+#if defined(LIBXSTREAM_STDFEATURES)
+    // typed enqueue (C++): the arguments are stored by value, and the signature is deduced at compile-time
+    {
+      libxstream_stream* stream = 0;
+      libxstream_graph* graph = 0;
+      std::vector<int> values(3, 1);
+      int sum = 0, ncalls = 0;
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_create(&stream, 0, 0, 0, "typed"));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream::enqueue(stream, [](const std::vector<int>& v, int scale, int& result) {
+        for (size_t i = 0; i < v.size(); ++i) result += scale * v[i];
+      }, values, 2, std::ref(sum)));
+      values[0] = 100; // copied when enqueued
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(stream));
+      LIBXSTREAM_CHECK_CONDITION_THROW(6 == sum);
+      // recorded work keeps its arguments until the graph is destroyed
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_graph_begin(stream));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream::enqueue(stream, [](int& n, std::vector<int> v) { n += v[0]; }, std::ref(ncalls), values));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_graph_end(stream, &graph));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_graph_launch(graph));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_graph_launch(graph));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(stream));
+      LIBXSTREAM_CHECK_CONDITION_THROW(200 == ncalls);
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_graph_destroy(graph));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_destroy(stream));
+    }
+#endif
+
+#if defined(LIBXSTREAM_TIMELINE) && (0 < (LIBXSTREAM_TIMELINE))
+    // every enqueued work item is recorded into the timeline (Chrome trace format)
+    {
+      const char *const filename = "test-timeline.json";
+      const size_t size = 4096;
+      std::vector<char> a(size, 'a'), b(size, 0), json(1 << 20, 0);
+      libxstream_stream* stream = 0;
+      void* dev = 0;
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_timeline_enable(0));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_create(&stream, 0, 0, 0, "timeline"));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_allocate(0, &dev, size, 0));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_memcpy_h2d(&a[0], dev, size, stream));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_memcpy_d2h(dev, &b[0], size, stream));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_sync(stream));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_timeline_disable());
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_timeline_write(filename));
+      FILE *const file = fopen(filename, "r");
+      LIBXSTREAM_CHECK_CONDITION_THROW(0 != file);
+      const size_t length = fread(&json[0], 1, json.size() - 1, file);
+      fclose(file);
+      std::remove(filename);
+      LIBXSTREAM_CHECK_CONDITION_THROW(a == b && 0 < length);
+      LIBXSTREAM_CHECK_CONDITION_THROW(0 != std::strstr(&json[0], "\"name\":\"h2d\"") && 0 != std::strstr(&json[0], "\"bytes\":4096"));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_mem_deallocate(0, dev));
+      LIBXSTREAM_CHECK_CALL_THROW(libxstream_stream_destroy(stream));
+    }
+#endif
+
+    // optional: enqueue throughput e.g., compare builds with and without LIBXSTREAM_CAPTURE_ARENA
+    const int nenqueues = 2 < argc ? std::atoi(argv[2]) : 0;
+    if (0 < nenqueues) {
+      double rate = 0;
+#if defined(_OPENMP)
+#     pragma omp parallel for schedule(static,1) reduction(+:rate)
+#endif
+      for (int i = 0; i < ntasks; ++i) {
+        rate += test_internal::enqueue(static_cast<int>(i % ndevices), nenqueues);
+      }
+#if defined(LIBXSTREAM_CAPTURE_ARENA) && (0 < (LIBXSTREAM_CAPTURE_ARENA))
+      fprintf(stdout, "Enqueue: %.2f M enqueues/s (arena)\n", rate * 1E-6);
+#else
+      fprintf(stdout, "Enqueue: %.2f M enqueues/s (heap)\n", rate * 1E-6);
+#endif
+    }
   }
   catch(const std::exception& e) {
     fprintf(stderr, "Error: %s\n", e.what());
@@ -33,8 +33,14 @@
 #include "libxstream_alloc.hpp"
 #include "libxstream_capture.hpp"
 #include "libxstream_context.hpp"
+#include "libxstream_copy.hpp"
 #include "libxstream_event.hpp"
+#include "libxstream_graph.hpp"
 #include "libxstream_offload.hpp"
+#include "libxstream_parking.hpp"
+#include "libxstream_pool.hpp"
+#include "libxstream_timeline.hpp"
+#include "libxstream_topology.hpp"
 
 #include <libxstream_begin.h>
 #include <algorithm>
@@ -71,6 +77,7 @@
 # include <windows.h>
 #else
 # include <unistd.h>
+# include <time.h>
 #endif
 
 
@@ -147,6 +154,306 @@ LIBXSTREAM_TARGET(mic) void mem_info(uint64_t& memory_physical, uint64_t& memory
 #endif
 }
 
+
+int mem_allocate(int device, void** memory, size_t size, size_t alignment)
+{
+  int result = LIBXSTREAM_ERROR_NONE;
+
+#if defined(LIBXSTREAM_OFFLOAD)
+  if (0 <= device) {
+    void* buffer = 0;
+    result = libxstream_virt_allocate(&buffer, size, alignment, &device, sizeof(device));
+
+    if (LIBXSTREAM_ERROR_NONE == result && 0 != buffer) {
+      LIBXSTREAM_ASYNC_BEGIN(0, device, buffer, size)
+      {
+        const char* buffer = ptr<const char,1>();
+        const size_t size = val<const size_t,2>();
+#       pragma offload_transfer target(mic:LIBXSTREAM_ASYNC_DEVICE) nocopy(buffer: length(size) LIBXSTREAM_OFFLOAD_ALLOC)
+      }
+      LIBXSTREAM_ASYNC_END(LIBXSTREAM_CALL_DEFAULT | LIBXSTREAM_CALL_WAIT, result);
+      LIBXSTREAM_CHECK_ERROR(result);
+      *memory = buffer;
+    }
+  }
+  else {
+#else
+  {
+    libxstream_use_sink(&device);
+#endif
+    void* buffer = 0;
+#if defined(LIBXSTREAM_ALLOC_PINNED)
+    result = 0 > device
+      ? libxstream_pinned_allocate(&buffer, size, alignment)
+      : libxstream_real_allocate(&buffer, size, alignment);
+#else
+    result = libxstream_real_allocate(&buffer, size, alignment);
+#endif
+
+    if (LIBXSTREAM_ERROR_NONE == result && 0 != buffer) {
+      // place the pages of a device buffer prior to the first touch (NUMA domain)
+      libxstream_topology::instance().bind_memory(libxstream_topology::domain(device), buffer, size);
+#if defined(LIBXSTREAM_OFFLOAD) && defined(LIBXSTREAM_ALLOC_PINNED)
+      LIBXSTREAM_ASYNC_BEGIN(0, device, buffer, size)
+      {
+        const char* buffer = ptr<const char,1>();
+        const size_t size = val<const size_t,2>();
+#       pragma offload_transfer target(mic) host_pin(buffer: length(size))
+      }
+      LIBXSTREAM_ASYNC_END(LIBXSTREAM_CALL_DEFAULT | LIBXSTREAM_CALL_WAIT, result);
+      LIBXSTREAM_CHECK_ERROR(result);
+#endif
+      *memory = buffer;
+    }
+  }
+
+  return result;
+}
+
+
+int mem_deallocate(int device, const void* memory)
+{
+  int result = LIBXSTREAM_ERROR_NONE;
+
+#if defined(LIBXSTREAM_OFFLOAD)
+  if (0 <= device) {
+# if defined(LIBXSTREAM_CHECK)
+    const int memory_device = *static_cast<const int*>(libxstream_virt_data(memory));
+    if (device != memory_device) {
+      LIBXSTREAM_PRINT_WARN("device %i does not match allocating device %i!", device, memory_device);
+      LIBXSTREAM_CHECK_CONDITION(0 <= memory_device);
+      device = memory_device;
+    }
+# endif
+# if !defined(LIBXSTREAM_SYNCMEM)
+    // streams are executed independently of the deallocation
+    libxstream_stream::sync(device);
+# endif
+    LIBXSTREAM_ASYNC_BEGIN(0, device, memory)
+    {
+      const char *const memory = ptr<const char,1>();
+#       pragma offload_transfer target(mic:LIBXSTREAM_ASYNC_DEVICE) nocopy(memory: length(0) LIBXSTREAM_OFFLOAD_FREE)
+      LIBXSTREAM_CHECK_CALL_ASSERT(status(libxstream_virt_deallocate(memory)));
+    }
+    LIBXSTREAM_ASYNC_END(LIBXSTREAM_CALL_DEFAULT, result);
+  }
+  else {
+#else
+  {
+    libxstream_use_sink(&device);
+#endif
+#if defined(LIBXSTREAM_OFFLOAD) && defined(LIBXSTREAM_ALLOC_PINNED)
+    LIBXSTREAM_ASYNC_BEGIN(0, device, memory)
+    {
+      const char* memory = ptr<const char,1>();
+#       pragma offload_transfer target(mic) host_unpin(memory: length(0))
+      LIBXSTREAM_CHECK_CALL_ASSERT(status(libxstream_pinned_deallocate(memory)));
+    }
+    LIBXSTREAM_ASYNC_END(LIBXSTREAM_CALL_DEFAULT, result);
+#elif defined(LIBXSTREAM_ALLOC_PINNED)
+    result = 0 > device ? libxstream_pinned_deallocate(memory) : libxstream_real_deallocate(memory);
+#else
+    result = libxstream_real_deallocate(memory);
+#endif
+  }
+
+  return result;
+}
+
+
+// appends a transfer to the batch; merges the transfer with its predecessor if both are contiguous
+void memcpy_batch_append(libxstream_memcpy_desc batch[], size_t& nbatch, const void* src, void* dst, size_t size)
+{
+  libxstream_memcpy_desc *const last = 0 < nbatch ? (batch + nbatch - 1) : 0;
+  if (last && static_cast<const char*>(last->src) + last->size == src && static_cast<char*>(last->dst) + last->size == dst) {
+    last->size += size;
+  }
+  else {
+    libxstream_memcpy_desc& desc = batch[nbatch++];
+    desc.src = src;
+    desc.dst = dst;
+    desc.size = size;
+  }
+}
+
+
+// copies the batch while merging contiguous neighbors; the copy (if any) is released by the work item
+int memcpy_batch_coalesce(const libxstream_memcpy_desc batch[], size_t nbatch, libxstream_memcpy_desc*& coalesced, size_t& ncoalesced, size_t& nbytes)
+{
+  LIBXSTREAM_CHECK_CONDITION(0 != batch || 0 == nbatch);
+  coalesced = 0;
+  ncoalesced = 0;
+  nbytes = 0;
+
+  for (size_t i = 0; i < nbatch; ++i) {
+    const libxstream_memcpy_desc& desc = batch[i];
+    LIBXSTREAM_CHECK_CONDITION(0 == desc.size || (desc.src && desc.dst && desc.src != desc.dst));
+    nbytes += desc.size;
+  }
+
+  if (0 < nbytes) {
+    coalesced = new libxstream_memcpy_desc[nbatch];
+    for (size_t i = 0; i < nbatch; ++i) {
+      const libxstream_memcpy_desc& desc = batch[i];
+      if (0 < desc.size) {
+        memcpy_batch_append(coalesced, ncoalesced, desc.src, desc.dst, desc.size);
+      }
+    }
+  }
+
+  return LIBXSTREAM_ERROR_NONE;
+}
+
+
+// host fallback of a batch of transfers; large batches are distributed across threads
+void memcpy_batch(const libxstream_memcpy_desc batch[], size_t nbatch, size_t nbytes)
+{
+  const int n = static_cast<int>(nbatch);
+  if ((LIBXSTREAM_MEMCPY_PARALLEL) <= (nbytes / nbatch)) { // large transfers are split
+    for (int i = 0; i < n; ++i) {
+      libxstream_copy(batch[i].dst, batch[i].src, batch[i].size);
+    }
+  }
+  else {
+#if defined(_OPENMP)
+#   pragma omp parallel for schedule(dynamic) num_threads(libxstream_copy_nthreads()) if(1 < n && (LIBXSTREAM_MEMCPY_PARALLEL) <= nbytes)
+#endif
+    for (int i = 0; i < n; ++i) {
+      libxstream_copy(batch[i].dst, batch[i].src, batch[i].size);
+    }
+  }
+}
+
+
+// enqueues a batch of transfers as a single work item which takes the ownership of the batch
+int memcpy_batch_enqueue(libxstream_memcpy_kind kind, libxstream_memcpy_desc batch[], size_t nbatch, size_t nbytes, libxstream_stream* stream)
+{
+  LIBXSTREAM_ASSERT(0 != batch && 0 < nbatch && stream);
+  int result = LIBXSTREAM_ERROR_NONE;
+  // a recorded batch is owned by the graph since the work can be launched many times
+  libxstream_graph *const graph = stream->graph();
+  if (0 != graph) {
+    graph->adopt(batch);
+  }
+
+  libxstream_capture_base::annotate(LIBXSTREAM_MEMCPY_H2D == kind ? "h2d" : (LIBXSTREAM_MEMCPY_D2H == kind ? "d2h" : "d2d"), nbytes, kind);
+  LIBXSTREAM_ASYNC_BEGIN(stream, batch, nbatch, nbytes, static_cast<int>(kind), static_cast<int>(0 == graph))
+  {
+    const libxstream_memcpy_desc *const batch = ptr<const libxstream_memcpy_desc,0>();
+    const size_t nbatch = val<const size_t,1>();
+    const size_t nbytes = val<const size_t,2>();
+
+#if defined(LIBXSTREAM_OFFLOAD)
+    if (0 <= LIBXSTREAM_ASYNC_DEVICE) {
+      const int kind = val<const int,3>();
+      if (!LIBXSTREAM_ASYNC_READY) {
+#       pragma offload_wait LIBXSTREAM_ASYNC_TARGET wait(LIBXSTREAM_ASYNC_PENDING)
+      }
+      // only the last transfer signals the completion of the work item
+      for (size_t i = 0; i < nbatch; ++i) {
+        const char *const src = static_cast<const char*>(batch[i].src);
+        char *const dst = static_cast<char*>(batch[i].dst);
+        const size_t size = batch[i].size;
+        const bool last = (i + 1) == nbatch;
+
+        switch (kind) {
+          case LIBXSTREAM_MEMCPY_H2D: if (last) {
+#           pragma offload_transfer LIBXSTREAM_ASYNC_TARGET_SIGNAL in(src: length(size) into(dst) LIBXSTREAM_OFFLOAD_REUSE)
+          }
+          else {
+#           pragma offload_transfer LIBXSTREAM_ASYNC_TARGET in(src: length(size) into(dst) LIBXSTREAM_OFFLOAD_REUSE)
+          } break;
+          case LIBXSTREAM_MEMCPY_D2H: if (last) {
+#           pragma offload_transfer LIBXSTREAM_ASYNC_TARGET_SIGNAL out(src: length(size) into(dst) LIBXSTREAM_OFFLOAD_REUSE)
+          }
+          else {
+#           pragma offload_transfer LIBXSTREAM_ASYNC_TARGET out(src: length(size) into(dst) LIBXSTREAM_OFFLOAD_REUSE)
+          } break;
+          default: if (last) {
+#           pragma offload LIBXSTREAM_ASYNC_TARGET_SIGNAL in(size) in(src: LIBXSTREAM_OFFLOAD_REFRESH) out(dst: LIBXSTREAM_OFFLOAD_REFRESH)
+            memcpy(dst, src, size);
+          }
+          else {
+#           pragma offload LIBXSTREAM_ASYNC_TARGET in(size) in(src: LIBXSTREAM_OFFLOAD_REFRESH) out(dst: LIBXSTREAM_OFFLOAD_REFRESH)
+            memcpy(dst, src, size);
+          }
+        }
+      }
+      libxstream_use_sink(&nbytes);
+    }
+    else
+#endif
+    {
+      memcpy_batch(batch, nbatch, nbytes);
+    }
+    if (0 != val<const int,4>()) {
+      delete[] batch;
+    }
+  }
+  LIBXSTREAM_ASYNC_END(LIBXSTREAM_CALL_DEFAULT, result);
+
+  return result;
+}
+
+
+// copies a block (extent) of a multi-dimensional array (column-major) as a batch of contiguous rows
+int memcpy_nd(libxstream_memcpy_kind kind, size_t dims, const void* src, void* dst, size_t typesize, const size_t extent[],
+  const int src_offset[], const size_t src_pitch[], const int dst_offset[], const size_t dst_pitch[], libxstream_stream* stream)
+{
+  LIBXSTREAM_CHECK_CONDITION(src && dst && 0 < typesize && extent && stream);
+  LIBXSTREAM_CHECK_CONDITION(src_offset && src_pitch && dst_offset && dst_pitch);
+  LIBXSTREAM_CHECK_CONDITION(LIBXSTREAM_MEMCPY_H2D == kind || LIBXSTREAM_MEMCPY_D2H == kind || LIBXSTREAM_MEMCPY_D2D == kind);
+  LIBXSTREAM_ASSERT(0 < dims && dims <= LIBXSTREAM_MAX_NDIMS);
+  size_t nrows = 1;
+
+  for (size_t i = 0; i < dims; ++i) {
+    LIBXSTREAM_CHECK_CONDITION(0 <= src_offset[i] && (static_cast<size_t>(src_offset[i]) + extent[i]) <= src_pitch[i]);
+    LIBXSTREAM_CHECK_CONDITION(0 <= dst_offset[i] && (static_cast<size_t>(dst_offset[i]) + extent[i]) <= dst_pitch[i]);
+    if (0 < i) nrows *= extent[i];
+  }
+
+  const size_t rowsize = extent[0] * typesize;
+  int result = LIBXSTREAM_ERROR_NONE;
+
+  if (0 < rowsize && 0 < nrows && (src != dst || LIBXSTREAM_MEMCPY_D2D != kind)) {
+    libxstream_memcpy_desc *const batch = new libxstream_memcpy_desc[nrows];
+    int src_index[LIBXSTREAM_MAX_NDIMS], dst_index[LIBXSTREAM_MAX_NDIMS];
+    size_t nbatch = 0;
+
+    for (size_t row = 0; row < nrows; ++row) {
+      src_index[0] = src_offset[0];
+      dst_index[0] = dst_offset[0];
+      for (size_t i = 1, r = row; i < dims; r /= extent[i], ++i) {
+        src_index[i] = src_offset[i] + static_cast<int>(r % extent[i]);
+        dst_index[i] = dst_offset[i] + static_cast<int>(r % extent[i]);
+      }
+      memcpy_batch_append(batch, nbatch,
+        static_cast<const char*>(src) + typesize * libxstream_linear_offset(dims, src_index, src_pitch),
+        static_cast<char*>(dst) + typesize * libxstream_linear_offset(dims, dst_index, dst_pitch),
+        rowsize);
+    }
+
+    result = memcpy_batch_enqueue(kind, batch, nbatch, rowsize * nrows, stream);
+  }
+
+  return result;
+}
+
+
+// callback of all streams (libxstream_stream_add_callback); the event recorded for all
+// streams is referred to by the enqueued work, and it is destroyed along with the callback
+struct callback_type {
+  callback_type(void (*fn)(void*), void* data): fn(fn), data(data) {}
+  static void run(void* callback) {
+    callback_type *const self = static_cast<callback_type*>(callback);
+    self->fn(self->data);
+    delete self;
+  }
+  void (*fn)(void*);
+  void* data;
+  libxstream_event event;
+};
+
 } // namespace libxstream_internal
 
 
@@ -395,6 +702,31 @@ void this_thread_sleep(size_t ms)
 }
 
 
+unsigned long long libxstream_timer_tick()
+{
+#if defined(LIBXSTREAM_STDFEATURES) && defined(LIBXSTREAM_STDFEATURES_THREADX)
+  typedef std::chrono::nanoseconds nanoseconds;
+  return static_cast<unsigned long long>(std::chrono::duration_cast<nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count());
+#elif defined(_WIN32)
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return static_cast<unsigned long long>(1E9 * counter.QuadPart / frequency.QuadPart);
+#else
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return 1000000000ULL * static_cast<unsigned long long>(t.tv_sec) + static_cast<unsigned long long>(t.tv_nsec);
+#endif
+}
+
+
+double libxstream_timer_duration(unsigned long long tick0, unsigned long long tick1)
+{
+  return tick0 < tick1 ? (1E-9 * (tick1 - tick0)) : 0.0;
+}
+
+
 LIBXSTREAM_EXPORT_C int libxstream_get_ndevices(size_t* ndevices)
 {
   LIBXSTREAM_CHECK_CONDITION(ndevices);
@@ -404,7 +736,7 @@ LIBXSTREAM_EXPORT_C int libxstream_get_ndevices(size_t* ndevices)
   LIBXSTREAM_CHECK_CONDITION(0 <= idevices);
   *ndevices = static_cast<size_t>(idevices);
 #else
-  *ndevices = 1; // host
+  *ndevices = libxstream_topology::instance().ndomains(); // host (NUMA domains or virtual devices)
 #endif
 
 #if defined(LIBXSTREAM_PRINT)
@@ -484,6 +816,11 @@ LIBXSTREAM_EXPORT_C int libxstream_mem_info(int device, size_t* allocatable, siz
     libxstream_internal::mem_info(memory_physical, memory_allocatable);
   }
 
+  // cached buffers are available for allocation
+  if (const libxstream_pool *const pool = libxstream_pool::instance(device)) {
+    memory_allocatable += pool->cached();
+  }
+
   LIBXSTREAM_PRINT_INFOCTX("device=%i allocatable=%lu physical=%lu", device,
     static_cast<unsigned long>(memory_allocatable),
     static_cast<unsigned long>(memory_physical));
@@ -539,44 +876,17 @@ LIBXSTREAM_EXPORT_C int libxstream_mem_allocate(int device, void** memory, size_
   LIBXSTREAM_CHECK_CONDITION(0 != memory);
   int result = LIBXSTREAM_ERROR_NONE;
 
-#if defined(LIBXSTREAM_OFFLOAD)
-  if (0 <= device) {
-    void* buffer = 0;
-    result = libxstream_virt_allocate(&buffer, size, alignment, &device, sizeof(device));
+  libxstream_pool *const pool = libxstream_pool::instance(device);
+  void *const cached = pool ? pool->acquire(size, alignment) : 0;
 
-    if (LIBXSTREAM_ERROR_NONE == result && 0 != buffer) {
-      LIBXSTREAM_ASYNC_BEGIN(0, device, buffer, size)
-      {
-        const char* buffer = ptr<const char,1>();
-        const size_t size = val<const size_t,2>();
-#       pragma offload_transfer target(mic:LIBXSTREAM_ASYNC_DEVICE) nocopy(buffer: length(size) LIBXSTREAM_OFFLOAD_ALLOC)
-      }
-      LIBXSTREAM_ASYNC_END(LIBXSTREAM_CALL_DEFAULT | LIBXSTREAM_CALL_WAIT, result);
-      LIBXSTREAM_CHECK_ERROR(result);
-      *memory = buffer;
+  if (0 == cached) {
+    result = libxstream_internal::mem_allocate(device, memory, size, alignment);
+    if (LIBXSTREAM_ERROR_NONE == result && pool) {
+      pool->track(*memory, size);
     }
   }
   else {
-#else
-  {
-    libxstream_use_sink(&device);
-#endif
-    void* buffer = 0;
-    result = libxstream_real_allocate(&buffer, size, alignment);
-
-    if (LIBXSTREAM_ERROR_NONE == result && 0 != buffer) {
-#if defined(LIBXSTREAM_OFFLOAD) && defined(LIBXSTREAM_ALLOC_PINNED)
-      LIBXSTREAM_ASYNC_BEGIN(0, device, buffer, size)
-      {
-        const char* buffer = ptr<const char,1>();
-        const size_t size = val<const size_t,2>();
-#       pragma offload_transfer target(mic) host_pin(buffer: length(size))
-      }
-      LIBXSTREAM_ASYNC_END(LIBXSTREAM_CALL_DEFAULT | LIBXSTREAM_CALL_WAIT, result);
-      LIBXSTREAM_CHECK_ERROR(result);
-#endif
-      *memory = buffer;
-    }
+    *memory = cached;
   }
 
 #if defined(LIBXSTREAM_SYNCMEM)
@@ -619,40 +929,15 @@ LIBXSTREAM_EXPORT_C int libxstream_mem_deallocate(int device, const void* memory
 #if defined(LIBXSTREAM_SYNCMEM)
     libxstream_stream::sync(device);
 #endif
-#if defined(LIBXSTREAM_OFFLOAD)
-    if (0 <= device) {
-# if defined(LIBXSTREAM_CHECK)
-      const int memory_device = *static_cast<const int*>(libxstream_virt_data(memory));
-      if (device != memory_device) {
-        LIBXSTREAM_PRINT_WARN("device %i does not match allocating device %i!", device, memory_device);
-        LIBXSTREAM_CHECK_CONDITION(0 <= memory_device);
-        device = memory_device;
-      }
-# endif
-      LIBXSTREAM_ASYNC_BEGIN(0, device, memory)
-      {
-        const char *const memory = ptr<const char,1>();
-#       pragma offload_transfer target(mic:LIBXSTREAM_ASYNC_DEVICE) nocopy(memory: length(0) LIBXSTREAM_OFFLOAD_FREE)
-        LIBXSTREAM_CHECK_CALL_ASSERT(status(libxstream_virt_deallocate(memory)));
-      }
-      LIBXSTREAM_ASYNC_END(LIBXSTREAM_CALL_DEFAULT, result);
+    libxstream_pool *const pool = libxstream_pool::instance(device);
+#if defined(LIBXSTREAM_OFFLOAD) && !defined(LIBXSTREAM_SYNCMEM)
+    if (pool && 0 <= device) {
+      // streams are executed independently of the deallocation i.e., sync before the buffer can be reused
+      libxstream_stream::sync(device);
     }
-    else {
-#else
-    {
-      libxstream_use_sink(&device);
-#endif
-#if defined(LIBXSTREAM_OFFLOAD) && defined(LIBXSTREAM_ALLOC_PINNED)
-      LIBXSTREAM_ASYNC_BEGIN(0, device, memory)
-      {
-        const char* memory = ptr<const char,1>();
-#       pragma offload_transfer target(mic) host_unpin(memory: length(0))
-        LIBXSTREAM_CHECK_CALL_ASSERT(status(libxstream_real_deallocate(memory)));
-      }
-      LIBXSTREAM_ASYNC_END(LIBXSTREAM_CALL_DEFAULT, result);
-#else
-      result = libxstream_real_deallocate(memory);
 #endif
+    if (0 == pool || !pool->release(memory)) {
+      result = libxstream_internal::mem_deallocate(device, memory);
     }
   }
 
@@ -660,6 +945,41 @@ LIBXSTREAM_EXPORT_C int libxstream_mem_deallocate(int device, const void* memory
 }
 
 
+LIBXSTREAM_EXPORT_C int libxstream_get_mem_stats(int device, libxstream_mem_stats* stats)
+{
+  LIBXSTREAM_CHECK_CONDITION(0 != stats);
+  const libxstream_pool *const pool = libxstream_pool::instance(device);
+  LIBXSTREAM_CHECK_CONDITION(0 != pool);
+  pool->stats(*stats);
+  return LIBXSTREAM_ERROR_NONE;
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_mem_pool_limit(int device, size_t limit)
+{
+  libxstream_pool *const pool = libxstream_pool::instance(device);
+  LIBXSTREAM_CHECK_CONDITION(0 != pool);
+  pool->limit(limit);
+  return libxstream_mem_trim(device, limit);
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_mem_trim(int device, size_t size)
+{
+  LIBXSTREAM_PRINT_INFOCTX("device=%i size=%lu", device, static_cast<unsigned long>(size));
+  libxstream_pool *const pool = libxstream_pool::instance(device);
+  LIBXSTREAM_CHECK_CONDITION(0 != pool);
+  int result = LIBXSTREAM_ERROR_NONE;
+
+  for (void* buffer = pool->evict(size); 0 != buffer; buffer = pool->evict(size)) {
+    result = libxstream_internal::mem_deallocate(device, buffer);
+    LIBXSTREAM_CHECK_ERROR(result);
+  }
+
+  return result;
+}
+
+
 LIBXSTREAM_EXPORT_C int libxstream_memset_zero(void* memory, size_t size, libxstream_stream* stream)
 {
   LIBXSTREAM_PRINT_INFO("libxstream_memset_zero: buffer=0x%llx size=%lu stream=0x%llx",
@@ -668,6 +988,7 @@ LIBXSTREAM_EXPORT_C int libxstream_memset_zero(void* memory, size_t size, libxst
   LIBXSTREAM_CHECK_CONDITION(memory && stream);
   int result = LIBXSTREAM_ERROR_NONE;
 
+  libxstream_capture_base::annotate("memset", size);
   LIBXSTREAM_ASYNC_BEGIN(stream, memory, size)
   {
     char* dst = ptr<char,0>();
@@ -687,7 +1008,7 @@ LIBXSTREAM_EXPORT_C int libxstream_memset_zero(void* memory, size_t size, libxst
     else
 #endif
     {
-      memset(dst, 0, size);
+      libxstream_zero(dst, size);
     }
   }
   LIBXSTREAM_ASYNC_END(LIBXSTREAM_CALL_DEFAULT, result);
@@ -703,6 +1024,7 @@ LIBXSTREAM_EXPORT_C int libxstream_memcpy_h2d(const void* host_mem, void* dev_me
   LIBXSTREAM_CHECK_CONDITION(host_mem && dev_mem && host_mem != dev_mem && stream);
   int result = LIBXSTREAM_ERROR_NONE;
 
+  libxstream_capture_base::annotate("h2d", size, LIBXSTREAM_MEMCPY_H2D);
   LIBXSTREAM_ASYNC_BEGIN(stream, host_mem, dev_mem, size)
   {
     const char *const src = ptr<const char,0>();
@@ -721,19 +1043,7 @@ LIBXSTREAM_EXPORT_C int libxstream_memcpy_h2d(const void* host_mem, void* dev_me
     else
 #endif
     {
-#if defined(LIBXSTREAM_ASYNCHOST)
-      if (LIBXSTREAM_ASYNC_READY) {
-#       pragma omp task depend(out:capture_region_signal) depend(in:LIBXSTREAM_ASYNC_PENDING)
-        std::copy(src, src + size, dst);
-      }
-      else {
-#       pragma omp task depend(out:capture_region_signal)
-        std::copy(src, src + size, dst);
-        ++capture_region_signal_consumed;
-      }
-#else
-      std::copy(src, src + size, dst);
-#endif
+      libxstream_copy(dst, src, size);
     }
   }
   LIBXSTREAM_ASYNC_END(LIBXSTREAM_CALL_DEFAULT, result);
@@ -749,6 +1059,7 @@ LIBXSTREAM_EXPORT_C int libxstream_memcpy_d2h(const void* dev_mem, void* host_me
   LIBXSTREAM_CHECK_CONDITION(dev_mem && host_mem && dev_mem != host_mem && stream);
   int result = LIBXSTREAM_ERROR_NONE;
 
+  libxstream_capture_base::annotate("d2h", size, LIBXSTREAM_MEMCPY_D2H);
   LIBXSTREAM_ASYNC_BEGIN(stream, dev_mem, host_mem, size)
   {
     const char* src = ptr<const char,0>();
@@ -767,7 +1078,7 @@ LIBXSTREAM_EXPORT_C int libxstream_memcpy_d2h(const void* dev_mem, void* host_me
     else
 #endif
     {
-      std::copy(src, src + size, dst);
+      libxstream_copy(dst, src, size);
     }
   }
   LIBXSTREAM_ASYNC_END(LIBXSTREAM_CALL_DEFAULT, result);
@@ -784,6 +1095,7 @@ LIBXSTREAM_EXPORT_C int libxstream_memcpy_d2d(const void* src, void* dst, size_t
   int result = LIBXSTREAM_ERROR_NONE;
 
   if (src != dst) {
+    libxstream_capture_base::annotate("d2d", size, LIBXSTREAM_MEMCPY_D2D);
     LIBXSTREAM_ASYNC_BEGIN(stream, src, dst, size)
     {
       const char *const src = ptr<const char,0>();
@@ -806,7 +1118,7 @@ LIBXSTREAM_EXPORT_C int libxstream_memcpy_d2d(const void* src, void* dst, size_t
       else
 #endif
       {
-        memcpy(dst, src, size);
+        libxstream_copy(dst, src, size);
       }
     }
     LIBXSTREAM_ASYNC_END(LIBXSTREAM_CALL_DEFAULT, result);
@@ -816,10 +1128,68 @@ LIBXSTREAM_EXPORT_C int libxstream_memcpy_d2d(const void* src, void* dst, size_t
 }
 
 
+LIBXSTREAM_EXPORT_C int libxstream_memcpy_h2d_batch(const libxstream_memcpy_desc batch[], size_t nbatch, libxstream_stream* stream)
+{
+  LIBXSTREAM_PRINT_INFO("libxstream_memcpy_h2d_batch: batch=0x%llx nbatch=%lu stream=0x%llx", reinterpret_cast<unsigned long long>(batch),
+    static_cast<unsigned long>(nbatch), reinterpret_cast<unsigned long long>(stream));
+  LIBXSTREAM_CHECK_CONDITION(stream);
+  libxstream_memcpy_desc* coalesced = 0;
+  size_t ncoalesced = 0, nbytes = 0;
+  int result = libxstream_internal::memcpy_batch_coalesce(batch, nbatch, coalesced, ncoalesced, nbytes);
+  LIBXSTREAM_CHECK_ERROR(result);
+
+  if (0 < ncoalesced) {
+    result = libxstream_internal::memcpy_batch_enqueue(LIBXSTREAM_MEMCPY_H2D, coalesced, ncoalesced, nbytes, stream);
+  }
+
+  return result;
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_memcpy_d2h_batch(const libxstream_memcpy_desc batch[], size_t nbatch, libxstream_stream* stream)
+{
+  LIBXSTREAM_PRINT_INFO("libxstream_memcpy_d2h_batch: batch=0x%llx nbatch=%lu stream=0x%llx", reinterpret_cast<unsigned long long>(batch),
+    static_cast<unsigned long>(nbatch), reinterpret_cast<unsigned long long>(stream));
+  LIBXSTREAM_CHECK_CONDITION(stream);
+  libxstream_memcpy_desc* coalesced = 0;
+  size_t ncoalesced = 0, nbytes = 0;
+  int result = libxstream_internal::memcpy_batch_coalesce(batch, nbatch, coalesced, ncoalesced, nbytes);
+  LIBXSTREAM_CHECK_ERROR(result);
+
+  if (0 < ncoalesced) {
+    result = libxstream_internal::memcpy_batch_enqueue(LIBXSTREAM_MEMCPY_D2H, coalesced, ncoalesced, nbytes, stream);
+  }
+
+  return result;
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_memcpy_2d(const void* src, void* dst, size_t typesize, const size_t extent[2],
+  const int src_offset[2], const size_t src_pitch[2], const int dst_offset[2], const size_t dst_pitch[2],
+  libxstream_memcpy_kind kind, libxstream_stream* stream)
+{
+  LIBXSTREAM_PRINT_INFO("libxstream_memcpy_2d: 0x%llx->0x%llx extent=%lux%lu kind=%i stream=0x%llx", reinterpret_cast<unsigned long long>(src),
+    reinterpret_cast<unsigned long long>(dst), static_cast<unsigned long>(extent ? extent[0] : 0), static_cast<unsigned long>(extent ? extent[1] : 0),
+    static_cast<int>(kind), reinterpret_cast<unsigned long long>(stream));
+  return libxstream_internal::memcpy_nd(kind, 2, src, dst, typesize, extent, src_offset, src_pitch, dst_offset, dst_pitch, stream);
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_memcpy_3d(const void* src, void* dst, size_t typesize, const size_t extent[3],
+  const int src_offset[3], const size_t src_pitch[3], const int dst_offset[3], const size_t dst_pitch[3],
+  libxstream_memcpy_kind kind, libxstream_stream* stream)
+{
+  LIBXSTREAM_PRINT_INFO("libxstream_memcpy_3d: 0x%llx->0x%llx extent=%lux%lux%lu kind=%i stream=0x%llx", reinterpret_cast<unsigned long long>(src),
+    reinterpret_cast<unsigned long long>(dst), static_cast<unsigned long>(extent ? extent[0] : 0), static_cast<unsigned long>(extent ? extent[1] : 0),
+    static_cast<unsigned long>(extent ? extent[2] : 0), static_cast<int>(kind), reinterpret_cast<unsigned long long>(stream));
+  return libxstream_internal::memcpy_nd(kind, 3, src, dst, typesize, extent, src_offset, src_pitch, dst_offset, dst_pitch, stream);
+}
+
+
 LIBXSTREAM_EXPORT_C int libxstream_stream_priority_range(int* least, int* greatest)
 {
-  *least = -1;
-  *greatest = -1;
+  LIBXSTREAM_CHECK_CONDITION(least && greatest);
+  libxstream_stream::priority_range(*least, *greatest);
   return LIBXSTREAM_ERROR_NONE;
 }
 
@@ -889,7 +1259,30 @@ LIBXSTREAM_EXPORT_C int libxstream_stream_wait_event(const libxstream_stream* st
 {
   LIBXSTREAM_PRINT_INFOCTX("event=0x%llx stream=0x%llx", reinterpret_cast<unsigned long long>(event), reinterpret_cast<unsigned long long>(stream));
   LIBXSTREAM_CHECK_CONDITION(0 != event);
-  return libxstream_event(*event).wait(stream);
+  // the stream waits for the event rather than blocking the caller
+  if (stream && stream->graph()) {
+    return stream->graph()->record_wait(*event);
+  }
+  return stream ? event->depend(*const_cast<libxstream_stream*>(stream)) : libxstream_event(*event).wait();
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_stream_add_callback(libxstream_stream* stream, void (*fn)(void*), void* data)
+{
+  LIBXSTREAM_PRINT_INFOCTX("stream=0x%llx fn=0x%llx data=0x%llx", reinterpret_cast<unsigned long long>(stream),
+    reinterpret_cast<unsigned long long>(fn), reinterpret_cast<unsigned long long>(data));
+  LIBXSTREAM_CHECK_CONDITION(0 != fn);
+  if (stream) { // subsequent work of the stream waits for the callback
+    return libxstream_offload(fn, 0, data, stream, LIBXSTREAM_CALL_DEFAULT);
+  }
+  // work enqueued so far into any stream (the streams are not waiting for the callback)
+  libxstream_internal::callback_type *const callback = new libxstream_internal::callback_type(fn, data);
+  const int result = libxstream_stream::enqueue(callback->event);
+  if (LIBXSTREAM_ERROR_NONE != result) {
+    delete callback; // nothing recorded
+    return result;
+  }
+  return callback->event.callback(libxstream_internal::callback_type::run, callback);
 }
 
 
@@ -928,6 +1321,14 @@ LIBXSTREAM_EXPORT_C int libxstream_stream_demux(const libxstream_stream* stream,
 }
 
 
+LIBXSTREAM_EXPORT_C int libxstream_stream_stats(const libxstream_stream* stream, libxstream_stream_counters* stats)
+{
+  LIBXSTREAM_CHECK_CONDITION(stream && stats);
+  stream->stats(*stats);
+  return LIBXSTREAM_ERROR_NONE;
+}
+
+
 LIBXSTREAM_EXPORT_C int libxstream_event_create(libxstream_event** event)
 {
   LIBXSTREAM_CHECK_CONDITION(event);
@@ -948,6 +1349,10 @@ LIBXSTREAM_EXPORT_C int libxstream_event_destroy(const libxstream_event* event)
 LIBXSTREAM_EXPORT_C int libxstream_event_record(libxstream_event* event, libxstream_stream* stream)
 {
   LIBXSTREAM_PRINT_INFOCTX("event=0x%llx stream=0x%llx", reinterpret_cast<unsigned long long>(event), reinterpret_cast<unsigned long long>(stream));
+  LIBXSTREAM_CHECK_CONDITION(event);
+  if (stream && stream->graph()) {
+    return stream->graph()->record_event(*event);
+  }
   return stream ? event->enqueue(*stream, true) : libxstream_stream::enqueue(*event);
 }
 
@@ -972,6 +1377,99 @@ LIBXSTREAM_EXPORT_C int libxstream_event_synchronize(libxstream_event* event)
 }
 
 
+LIBXSTREAM_EXPORT_C int libxstream_event_add_callback(const libxstream_event* event, void (*fn)(void*), void* data)
+{
+  LIBXSTREAM_PRINT_INFOCTX("event=0x%llx fn=0x%llx data=0x%llx", reinterpret_cast<unsigned long long>(event),
+    reinterpret_cast<unsigned long long>(fn), reinterpret_cast<unsigned long long>(data));
+  LIBXSTREAM_CHECK_CONDITION(event && fn);
+  return event->callback(fn, data);
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_get_wait_stats(libxstream_wait_stats* stats)
+{
+  LIBXSTREAM_CHECK_CONDITION(0 != stats);
+  libxstream_parking::stats(*stats);
+  return LIBXSTREAM_ERROR_NONE;
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_timeline_enable(const char* filename)
+{
+  LIBXSTREAM_PRINT_INFOCTX("filename=%s", filename ? filename : "<none>");
+#if defined(LIBXSTREAM_TIMELINE) && (0 < (LIBXSTREAM_TIMELINE))
+  libxstream_timeline::enable(filename);
+  return LIBXSTREAM_ERROR_NONE;
+#else
+  libxstream_use_sink(filename);
+  return LIBXSTREAM_ERROR_RUNTIME;
+#endif
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_timeline_disable(void)
+{
+  libxstream_timeline::disable();
+  return LIBXSTREAM_ERROR_NONE;
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_timeline_write(const char* filename)
+{
+  LIBXSTREAM_PRINT_INFOCTX("filename=%s", filename ? filename : "<none>");
+  LIBXSTREAM_CHECK_CONDITION(filename);
+  return libxstream_timeline::write(filename);
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_graph_begin(libxstream_stream* stream)
+{
+  LIBXSTREAM_PRINT_INFOCTX("stream=0x%llx", reinterpret_cast<unsigned long long>(stream));
+  LIBXSTREAM_CHECK_CONDITION(stream && 0 == stream->graph());
+  stream->graph(new libxstream_graph(*stream));
+  return LIBXSTREAM_ERROR_NONE;
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_graph_end(libxstream_stream* stream, libxstream_graph** graph)
+{
+  LIBXSTREAM_CHECK_CONDITION(stream && 0 != stream->graph() && graph);
+  *graph = stream->graph();
+  stream->graph(0);
+  LIBXSTREAM_PRINT_INFOCTX("stream=0x%llx graph=0x%llx nodes=%lu", reinterpret_cast<unsigned long long>(stream),
+    reinterpret_cast<unsigned long long>(*graph), static_cast<unsigned long>((*graph)->size()));
+  return LIBXSTREAM_ERROR_NONE;
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_graph_update(libxstream_graph* graph, const void* from, const void* to, size_t* nupdated)
+{
+  LIBXSTREAM_CHECK_CONDITION(graph);
+  const size_t n = graph->update(from, to);
+  LIBXSTREAM_PRINT_INFOCTX("graph=0x%llx 0x%llx->0x%llx n=%lu", reinterpret_cast<unsigned long long>(graph),
+    reinterpret_cast<unsigned long long>(from), reinterpret_cast<unsigned long long>(to), static_cast<unsigned long>(n));
+  if (nupdated) *nupdated = n;
+  return LIBXSTREAM_ERROR_NONE;
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_graph_launch(libxstream_graph* graph)
+{
+  LIBXSTREAM_PRINT_INFOCTX("graph=0x%llx", reinterpret_cast<unsigned long long>(graph));
+  // launching into the stream which records the graph is not supported
+  LIBXSTREAM_CHECK_CONDITION(graph && 0 == graph->stream().graph());
+  return graph->launch();
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_graph_destroy(const libxstream_graph* graph)
+{
+  LIBXSTREAM_PRINT_INFOCTX("graph=0x%llx", reinterpret_cast<unsigned long long>(graph));
+  delete graph;
+  return LIBXSTREAM_ERROR_NONE;
+}
+
+
 LIBXSTREAM_EXPORT_C int libxstream_fn_create_signature(libxstream_argument** signature, size_t nargs)
 {
   if (0 < nargs) {
@@ -1086,6 +1584,61 @@ LIBXSTREAM_EXPORT_C int libxstream_fn_call(libxstream_function function, const l
 }
 
 
+LIBXSTREAM_EXPORT_C int libxstream_fn_enqueue(void (*run)(void*), void (*destroy)(void*), void* data, libxstream_stream* stream, int flags)
+{
+  LIBXSTREAM_PRINT_INFOCTX("run=0x%llx data=0x%llx stream=0x%llx flags=%i",
+    reinterpret_cast<unsigned long long>(run), reinterpret_cast<unsigned long long>(data),
+    reinterpret_cast<unsigned long long>(stream), flags);
+  if (0 != run && 0 != stream) {
+    return libxstream_offload(run, destroy, data, stream, flags);
+  }
+  if (destroy) { // owned by the library
+    destroy(data);
+  }
+  return LIBXSTREAM_ERROR_CONDITION;
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_fn_register_signature(const libxstream_argument* signature, const libxstream_argument** handle)
+{
+  LIBXSTREAM_CHECK_CONDITION(0 != handle);
+  size_t arity = 0;
+  if (signature) {
+    LIBXSTREAM_CHECK_CALL(libxstream_get_arity(signature, &arity));
+  }
+  *handle = libxstream_capture_base::register_signature(signature, arity);
+  LIBXSTREAM_PRINT_INFOCTX("signature=0x%llx handle=0x%llx arity=%lu", reinterpret_cast<unsigned long long>(signature),
+    reinterpret_cast<unsigned long long>(*handle), static_cast<unsigned long>(arity));
+  return LIBXSTREAM_ERROR_NONE;
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_fn_unregister_signature(const libxstream_argument* handle)
+{
+  LIBXSTREAM_PRINT_INFOCTX("handle=0x%llx", reinterpret_cast<unsigned long long>(handle));
+  if (handle) { // released once no enqueued call refers to it anymore
+    libxstream_capture_base::unregister_signature(handle);
+  }
+  return LIBXSTREAM_ERROR_NONE;
+}
+
+
+LIBXSTREAM_EXPORT_C int libxstream_fn_call_registered(libxstream_function function, const libxstream_argument* handle,
+  const void* values[], size_t nvalues, libxstream_stream* stream, int flags)
+{
+  LIBXSTREAM_PRINT_INFOCTX("function=0x%llx handle=0x%llx nvalues=%lu stream=0x%llx flags=%i",
+    reinterpret_cast<unsigned long long>(function), reinterpret_cast<unsigned long long>(handle),
+    static_cast<unsigned long>(nvalues), reinterpret_cast<unsigned long long>(stream), flags);
+  LIBXSTREAM_CHECK_CONDITION(0 != function && 0 != handle && 0 != stream && (0 != values || 0 == nvalues));
+#if defined(LIBXSTREAM_CHECK)
+  size_t arity = 0;
+  LIBXSTREAM_CHECK_CALL(libxstream_get_arity(handle, &arity));
+  LIBXSTREAM_CHECK_CONDITION(nvalues <= arity);
+#endif
+  return libxstream_offload(function, handle, values, nvalues, stream, flags);
+}
+
+
 LIBXSTREAM_EXPORT_C LIBXSTREAM_TARGET(mic) int libxstream_get_typesize(libxstream_type type, size_t* typesize)
 {
   LIBXSTREAM_CHECK_CONDITION(0 != typesize);
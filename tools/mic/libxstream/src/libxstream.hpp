@@ -51,6 +51,11 @@ int this_thread_id();
 void this_thread_yield();
 void this_thread_sleep(size_t ms = 1);
 
+// Monotonic time stamp (nanoseconds).
+unsigned long long libxstream_timer_tick();
+// Duration (seconds) between two time stamps.
+double libxstream_timer_duration(unsigned long long tick0, unsigned long long tick1);
+
 enum {
   LIBXSTREAM_CALL_UNLOCK    = (2 * (LIBXSTREAM_CALL_INVALID - 1)),
   LIBXSTREAM_CALL_EXTERNAL  = (4 * (LIBXSTREAM_CALL_INVALID - 1))
@@ -44,6 +44,7 @@
 #else
 # include <xmmintrin.h>
 # include <sys/mman.h>
+# include <unistd.h>
 #endif
 
 
@@ -65,6 +66,38 @@ LIBXSTREAM_TARGET(mic) S linear_size(size_t dims, const T shape[], S initial_siz
   return result;
 }
 
+
+// bookkeeping of a pinned allocation; stored in front of the buffer
+struct pinned_type {
+  void* m_base;
+  size_t m_size;
+};
+
+
+size_t page_size()
+{
+#if defined(_WIN32)
+  static size_t result = 0;
+  if (0 == result) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    result = info.dwPageSize;
+  }
+#else
+  static const size_t result = sysconf(_SC_PAGESIZE);
+#endif
+  return result;
+}
+
+
+// prefault the pages of a buffer which could not be locked
+void touch(char* buffer, size_t size, size_t page)
+{
+  for (size_t i = 0; i < size; i += page) {
+    static_cast<volatile char*>(buffer)[i] = 0;
+  }
+}
+
 } // namespace libxstream_alloc_internal
 
 
@@ -187,8 +220,11 @@ int libxstream_real_allocate(void** memory, size_t size, size_t alignment)
   if (memory) {
     if (0 < size) {
 #if defined(LIBXSTREAM_DEBUG)
-      LIBXSTREAM_USE_SINK(&alignment);
-      if (char *const buffer = new char[size]) {
+      // aligned as in release builds (e.g., the memory pool filters on the alignment); the allocation precedes the buffer
+      const size_t auto_alignment = libxstream_alignment(size, alignment);
+      if (char *const allocation = new char[sizeof(char*) + auto_alignment + size]) {
+        char *const buffer = static_cast<char*>(libxstream_align(allocation + sizeof(char*), auto_alignment));
+        reinterpret_cast<char**>(buffer)[-1] = allocation;
         std::fill_n(buffer, size, 0);
         *memory = buffer;
       }
@@ -261,7 +297,7 @@ int libxstream_real_deallocate(const void* memory)
 {
   if (memory) {
 #if defined(LIBXSTREAM_DEBUG)
-    delete[] static_cast<const char*>(memory);
+    delete[] static_cast<char* const*>(memory)[-1];
 #elif defined(__MKL)
     mkl_free(const_cast<void*>(memory));
 #elif defined(_WIN32)
@@ -277,6 +313,100 @@ int libxstream_real_deallocate(const void* memory)
 }
 
 
+int libxstream_pinned_allocate(void** memory, size_t size, size_t alignment)
+{
+  using namespace libxstream_alloc_internal;
+  int result = LIBXSTREAM_ERROR_NONE;
+
+  if (memory) {
+    if (0 < size) {
+      const size_t page = page_size(), huge = LIBXSTREAM_MAX_ALIGN;
+      // large buffers are aligned to be backed by huge pages
+      const bool large = huge <= size && page < huge;
+      const size_t auto_alignment = std::max(libxstream_alignment(size, alignment), large ? huge : page);
+      const size_t granularity = large ? huge : page, extent = ((size + granularity - 1) / granularity) * granularity;
+      // one page in front of the buffer keeps the bookkeeping
+      const size_t mapped = page + auto_alignment + extent;
+#if defined(_WIN32)
+      char *const base = static_cast<char*>(VirtualAlloc(0, mapped, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+      LIBXSTREAM_CHECK_CONDITION(0 != base);
+#else
+      char *const base = static_cast<char*>(mmap(0, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+      LIBXSTREAM_CHECK_CONDITION(MAP_FAILED != base);
+#endif
+      char *const buffer = static_cast<char*>(libxstream_align(base + page, auto_alignment));
+      LIBXSTREAM_ASSERT(buffer + extent <= base + mapped);
+      pinned_type& info = reinterpret_cast<pinned_type*>(buffer)[-1];
+      info.m_base = base;
+      info.m_size = mapped;
+
+#if !defined(_WIN32)
+      if (large) {
+# if defined(MAP_HUGETLB) && (2 == ((2*LIBXSTREAM_ALLOC_PINNED+1)/2))
+        // explicit huge pages (if reserved by the system) replace the pages of the buffer
+        if (MAP_FAILED == mmap(buffer, extent, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB, -1, 0)) {
+          // the failed attempt might have unmapped the pages of the buffer (regular pages instead)
+          if (MAP_FAILED == mmap(buffer, extent, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0)) {
+            munmap(base, mapped);
+            return LIBXSTREAM_ERROR_RUNTIME;
+          }
+# else
+        {
+# endif
+# if defined(MADV_HUGEPAGE)
+          madvise(buffer, extent, MADV_HUGEPAGE); // transparent huge pages
+# endif
+        }
+      }
+#endif
+
+#if defined(_WIN32)
+      const bool locked = FALSE != VirtualLock(buffer, size);
+#else
+      const bool locked = 0 == mlock(buffer, size);
+#endif
+      if (!locked) { // e.g., RLIMIT_MEMLOCK is too small
+        static bool warned = false;
+        if (!warned) {
+          LIBXSTREAM_PRINT_WARN("failed to lock %lu Byte; falling back to pageable memory!", static_cast<unsigned long>(size));
+          warned = true;
+        }
+        touch(buffer, size, page);
+      }
+      *memory = buffer;
+    }
+    else {
+      *memory = 0;
+    }
+  }
+#if defined(LIBXSTREAM_CHECK)
+  else if (0 != size) {
+    result = LIBXSTREAM_ERROR_CONDITION;
+  }
+#endif
+
+  return result;
+}
+
+
+int libxstream_pinned_deallocate(const void* memory)
+{
+  int result = LIBXSTREAM_ERROR_NONE;
+
+  if (memory) {
+    const libxstream_alloc_internal::pinned_type& info = static_cast<const libxstream_alloc_internal::pinned_type*>(memory)[-1];
+    // unmapping also unlocks the pages
+#if defined(_WIN32)
+    result = FALSE != VirtualFree(info.m_base, 0, MEM_RELEASE) ? LIBXSTREAM_ERROR_NONE : LIBXSTREAM_ERROR_RUNTIME;
+#else
+    result = 0 == munmap(info.m_base, info.m_size) ? LIBXSTREAM_ERROR_NONE : LIBXSTREAM_ERROR_RUNTIME;
+#endif
+  }
+
+  return result;
+}
+
+
 int libxstream_virt_allocate(void** memory, size_t size, size_t alignment, const void* data, size_t data_size)
 {
   LIBXSTREAM_CHECK_CONDITION(0 == data_size || 0 != data);
@@ -54,6 +54,10 @@ LIBXSTREAM_TARGET(mic) size_t libxstream_linear_address(size_t dims, const int o
 int libxstream_real_allocate(void** memory, size_t size, size_t alignment);
 int libxstream_real_deallocate(const void* memory);
 
+// Page-locked memory (prefaulted if the memory cannot be locked); large buffers are backed by huge pages.
+int libxstream_pinned_allocate(void** memory, size_t size, size_t alignment);
+int libxstream_pinned_deallocate(const void* memory);
+
 int libxstream_virt_allocate(void** memory, size_t size, size_t alignment, const void* data = 0, size_t data_size = 0);
 int libxstream_virt_deallocate(const void* memory);
 
@@ -0,0 +1,184 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#include "libxstream_arena.hpp"
+#include "libxstream_alloc.hpp"
+
+#include <libxstream_begin.h>
+#include <new>
+#include <libxstream_end.h>
+
+
+struct libxstream_arena::slot_type {
+  libxstream_arena* m_arena; // NULL if the memory is served by the heap
+  slot_type* m_next;
+};
+
+
+namespace libxstream_arena_internal {
+
+// the header (owner and link) is padded to keep the payload of each slot aligned
+const size_t header_size = LIBXSTREAM_MAX_SIMD;
+
+
+template<typename T> T* header(void* memory)
+{
+  return reinterpret_cast<T*>(static_cast<char*>(memory) - header_size);
+}
+
+
+template<typename T> void* payload(T* slot)
+{
+  return reinterpret_cast<char*>(slot) + header_size;
+}
+
+} // namespace libxstream_arena_internal
+
+
+libxstream_arena::libxstream_arena(size_t slotsize, size_t nslots)
+  : m_slotsize(libxstream_align(slotsize, LIBXSTREAM_MAX_SIMD))
+  , m_nslots(0 < nslots ? nslots : 1)
+  , m_local(0), m_chunks(0)
+  , m_remote(0)
+#if !defined(LIBXSTREAM_STDFEATURES)
+  , m_lock(libxstream_lock_create())
+#endif
+{}
+
+
+libxstream_arena::~libxstream_arena()
+{
+  // all slots must have been returned to the arena
+  while (m_chunks) {
+    void *const next = *static_cast<void**>(m_chunks);
+    LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_real_deallocate(m_chunks));
+    m_chunks = next;
+  }
+#if !defined(LIBXSTREAM_STDFEATURES)
+  libxstream_lock_destroy(m_lock);
+#endif
+}
+
+
+void* libxstream_arena::allocate(size_t size)
+{
+  using namespace libxstream_arena_internal;
+  slot_type* slot = 0;
+
+  if (size <= m_slotsize) {
+    slot = m_local ? m_local : refill();
+    if (slot) {
+      m_local = slot->m_next;
+    }
+  }
+  else if (void *const buffer = ::operator new(header_size + size, std::nothrow)) {
+    slot = static_cast<slot_type*>(buffer);
+    slot->m_arena = 0;
+  }
+
+  return slot ? payload(slot) : 0;
+}
+
+
+void libxstream_arena::deallocate(void* memory, libxstream_arena* self)
+{
+  using namespace libxstream_arena_internal;
+  if (memory) {
+    slot_type *const slot = header<slot_type>(memory);
+    libxstream_arena *const arena = slot->m_arena;
+
+    if (0 == arena) {
+      ::operator delete(slot);
+    }
+    else if (self == arena) {
+      slot->m_next = arena->m_local;
+      arena->m_local = slot;
+    }
+    else { // hand the slot back to the owner
+#if defined(LIBXSTREAM_STDFEATURES)
+      slot_type* head = arena->m_remote.load(std::memory_order_relaxed);
+      do {
+        slot->m_next = head;
+      }
+      while (!arena->m_remote.compare_exchange_weak(head, slot, std::memory_order_release, std::memory_order_relaxed));
+#elif defined(__GNUC__)
+      slot_type* head = 0;
+      do {
+        head = arena->m_remote;
+        slot->m_next = head;
+      }
+      while (!__sync_bool_compare_and_swap(&arena->m_remote, head, slot));
+#else // generic
+      libxstream_lock_acquire(arena->m_lock);
+      slot->m_next = arena->m_remote;
+      arena->m_remote = slot;
+      libxstream_lock_release(arena->m_lock);
+#endif
+    }
+  }
+}
+
+
+libxstream_arena::slot_type* libxstream_arena::refill()
+{
+  using namespace libxstream_arena_internal;
+  // take all slots which were released by other threads
+#if defined(LIBXSTREAM_STDFEATURES)
+  slot_type* result = m_remote.load(std::memory_order_relaxed) ? m_remote.exchange(0, std::memory_order_acquire) : 0;
+#elif defined(__GNUC__)
+  slot_type* result = m_remote ? __sync_lock_test_and_set(&m_remote, static_cast<slot_type*>(0)) : 0;
+#else // generic
+  libxstream_lock_acquire(m_lock);
+  slot_type* result = m_remote;
+  m_remote = 0;
+  libxstream_lock_release(m_lock);
+#endif
+
+  if (0 == result) { // grow the arena by another chunk of slots
+    const size_t stride = header_size + m_slotsize;
+    void* chunk = 0;
+    if (LIBXSTREAM_ERROR_NONE == libxstream_real_allocate(&chunk, header_size + m_nslots * stride, LIBXSTREAM_MAX_SIMD) && chunk) {
+      *static_cast<void**>(chunk) = m_chunks;
+      m_chunks = chunk;
+      char *const slots = static_cast<char*>(chunk) + header_size;
+      for (size_t i = m_nslots; 0 < i; --i) {
+        slot_type *const slot = reinterpret_cast<slot_type*>(slots + (i - 1) * stride);
+        slot->m_arena = this;
+        slot->m_next = result;
+        result = slot;
+      }
+    }
+  }
+
+  return result;
+}
+
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
@@ -0,0 +1,85 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#ifndef LIBXSTREAM_ARENA_HPP
+#define LIBXSTREAM_ARENA_HPP
+
+#include "libxstream.hpp"
+
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+
+#include <libxstream_begin.h>
+#if defined(LIBXSTREAM_STDFEATURES)
+# include <atomic>
+#endif
+#include <libxstream_end.h>
+
+
+/**
+ * Pool of fixed-size slots which is owned by a single (producer) thread.
+ * Only the owner allocates; any thread can deallocate a slot, which hands
+ * the slot back to the owner (lock-free list of remotely freed slots).
+ * Requests which are larger than a slot are served by the heap.
+ */
+struct libxstream_arena {
+public:
+  libxstream_arena(size_t slotsize, size_t nslots);
+  ~libxstream_arena();
+
+public:
+  // Allocate memory (owning thread only).
+  void* allocate(size_t size);
+
+  // Release memory which was allocated by any arena; "self" is the arena of the calling thread (can be NULL).
+  static void deallocate(void* memory, libxstream_arena* self);
+
+private:
+  libxstream_arena(const libxstream_arena& other);
+  libxstream_arena& operator=(const libxstream_arena& other);
+
+  struct slot_type;
+  slot_type* refill();
+
+private:
+  size_t m_slotsize, m_nslots;
+  slot_type* m_local;
+  void* m_chunks;
+  // avoid false sharing between the owner and remote threads
+  char m_pad[LIBXSTREAM_MAX_SIMD];
+#if defined(LIBXSTREAM_STDFEATURES)
+  std::atomic<slot_type*> m_remote;
+#else
+  slot_type* volatile m_remote;
+  libxstream_lock* m_lock;
+#endif
+};
+
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#endif // LIBXSTREAM_ARENA_HPP
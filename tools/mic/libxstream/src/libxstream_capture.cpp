@@ -30,19 +30,18 @@
 ******************************************************************************/
 #if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
 #include "libxstream_capture.hpp"
+#include "libxstream_worker.hpp"
+#include "libxstream_arena.hpp"
+#include "libxstream_graph.hpp"
+#include "libxstream_timeline.hpp"
 
 #include <libxstream_begin.h>
 #include <algorithm>
-#include <cstdio>
+#include <new>
 #if defined(LIBXSTREAM_STDFEATURES)
-# include <thread>
 # include <atomic>
-#else
-# if defined(__GNUC__)
-#   include <pthread.h>
-# else
-#   include <Windows.h>
-# endif
+#elif !defined(__GNUC__)
+# include <Windows.h>
 #endif
 #include <libxstream_end.h>
 
@@ -52,225 +51,104 @@
 
 namespace libxstream_capture_internal {
 
-class queue_type {
-public:
-  queue_type()
-    : m_lock(libxstream_lock_create())
-    , m_index(0)
-#if defined(LIBXSTREAM_STDFEATURES)
-    , m_thread() // do not start here
-#else
-    , m_thread(0)
-#endif
-    , m_size(0)
-    , m_status(LIBXSTREAM_ERROR_NONE)
-  {
-    std::fill_n(m_buffer, LIBXSTREAM_MAX_QSIZE, static_cast<libxstream_capture_base*>(0));
-#if defined(LIBXSTREAM_STDFEATURES)
-    std::thread(run, this).swap(m_thread);
-#else
-# if defined(__GNUC__)
-    pthread_create(&m_thread, 0, run, this);
-# else
-    m_thread = CreateThread(0, 0, run, this, 0, 0);
-# endif
-#endif
-  }
-
-  ~queue_type() {
-    // terminates the background thread
-    push(terminator, true);
-#if defined(LIBXSTREAM_STDFEATURES)
-    m_thread.detach();
-#else
-# if defined(__GNUC__)
-    pthread_detach(m_thread);
-# else
-    CloseHandle(m_thread);
-# endif
-#endif
-#if defined(LIBXSTREAM_DEBUG)
-    size_t dangling = 0;
-    for (size_t i = 0; i < LIBXSTREAM_MAX_QSIZE; ++i) {
-      const libxstream_capture_base* item = m_buffer[i];
-      if (0 != item && terminator != item) {
-        m_buffer[i] = 0;
-        ++dangling;
-        delete item;
-      }
-    }
-    if (0 < dangling) {
-      LIBXSTREAM_PRINT_WARN("%lu work item%s dangling!", static_cast<unsigned long>(dangling), 1 < dangling ? "s are" : " is");
-    }
-#endif
-    libxstream_lock_destroy(m_lock);
-  }
-
-public:
-  int status(int code) {
-#if defined(LIBXSTREAM_STDFEATURES)
-    return std::atomic_exchange(&m_status, code);
-#elif defined(_OPENMP)
-    int result = 0;
-#   pragma omp critical
-    {
-      result = m_status;
-      m_status = code;
-    }
-    return result;
-#else // generic
-    int result = 0;
-    libxstream_lock_acquire(m_lock);
-    result = m_status;
-    m_status = code;
-    libxstream_lock_release(m_lock);
-    return result;
-#endif
-  }
-
-  bool empty() const {
-    return 0 == get();
-  }
-
-  /*size_t size() const {
-    const size_t offset = m_size, index = m_index;
-    const libxstream_capture_base *const entry = m_buffer[offset%LIBXSTREAM_MAX_QSIZE];
-    return 0 != entry ? (offset - index) : (std::max<size_t>(offset - index, 1) - 1);
-  }*/
+#if !defined(LIBXSTREAM_CAPTURE_DEBUG)
+// executes work which is not associated with a stream; never destroyed
+// since work can be enqueued beyond the lifetime of static objects
+libxstream_worker& queue()
+{
+  static libxstream_worker *const instance = new libxstream_worker;
+  return *instance;
+}
 
-  void push(const libxstream_capture_base& capture_region, bool wait) {
-    push(&capture_region, wait);
-  }
 
-  libxstream_capture_base* get() const { // not thread-safe!
-    return m_buffer[m_index%LIBXSTREAM_MAX_QSIZE];
+// completes the work which is not associated with a stream at exit
+struct drain_type {
+  ~drain_type() {
+    libxstream_worker& q = queue();
+    q.wait(q.ticket());
   }
+} drain;
 
-  void pop() { // not thread-safe!
-    LIBXSTREAM_ASSERT(!empty());
-    m_buffer[m_index%LIBXSTREAM_MAX_QSIZE] = 0;
-    ++m_index;
-  }
 
-private:
-  void push(const libxstream_capture_base* capture_region, bool wait) {
-    LIBXSTREAM_ASSERT(0 != capture_region);
-    libxstream_capture_base** entry = 0;
-#if defined(LIBXSTREAM_STDFEATURES)
-    entry = m_buffer + (m_size++ % LIBXSTREAM_MAX_QSIZE);
-#elif defined(_OPENMP)
-    size_t size1 = 0;
-# if (201107 <= _OPENMP)
-#   pragma omp atomic capture
-# else
-#   pragma omp critical
-# endif
-    size1 = ++m_size;
-    entry = m_buffer + ((size1 - 1) % LIBXSTREAM_MAX_QSIZE);
-#else // generic
-    libxstream_lock_acquire(m_lock);
-    entry = m_buffer + (m_size++ % LIBXSTREAM_MAX_QSIZE);
-    libxstream_lock_release(m_lock);
+libxstream_worker& worker(const libxstream_capture_base& capture_region)
+{
+  libxstream_stream *const stream = capture_region.stream();
+  return stream ? stream->worker() : queue();
+}
 #endif
-    LIBXSTREAM_ASSERT(0 != entry);
 
-#if defined(LIBXSTREAM_DEBUG)
-    if (0 != *entry) {
-      LIBXSTREAM_PRINT_WARN0("queuing work is stalled!");
-    }
+#if defined(LIBXSTREAM_CAPTURE_ARENA) && (0 < (LIBXSTREAM_CAPTURE_ARENA))
+// arena of the producer thread; never destroyed since consumers may still hold regions
+LIBXSTREAM_TLS libxstream_arena* arena = 0;
 #endif
-    // stall the push if LIBXSTREAM_MAX_QSIZE is exceeded
-    while (0 != *entry) {
-      this_thread_yield();
-    }
-
-    LIBXSTREAM_ASSERT(0 == *entry);
-    libxstream_capture_base* new_entry = terminator != capture_region ? capture_region->clone() : terminator;
-    *entry = new_entry;
-
-    if (wait) {
-      while (new_entry == *entry) {
-        this_thread_yield();
-      }
-    }
-  }
 
-#if defined(LIBXSTREAM_STDFEATURES) || defined(__GNUC__)
-  static void* run(void* queue)
+// a registered signature is preceded by its reference count (stored in place of an argument)
+#if defined(LIBXSTREAM_STDFEATURES)
+typedef std::atomic<size_t> refcount_type;
 #else
-  static DWORD WINAPI run(_In_ LPVOID queue)
+typedef volatile size_t refcount_type;
 #endif
-  {
-    queue_type& q = *static_cast<queue_type*>(queue);
-    libxstream_capture_base* capture_region = 0;
-    bool never = false;
 
-#if defined(LIBXSTREAM_ASYNCHOST) && defined(_OPENMP) && !defined(LIBXSTREAM_OFFLOAD)
-#   pragma omp parallel
-#   pragma omp master
-#endif
-    for (;;) {
-      size_t cycle = 0;
-      while (0 == (capture_region = q.get())) {
-        if ((LIBXSTREAM_WAIT_ACTIVE_CYCLES) > cycle) {
-          this_thread_yield();
-          ++cycle;
-        }
-        else {
-          this_thread_sleep();
-        }
-      }
 
-      if (terminator != capture_region) {
-        (*capture_region)();
-        delete capture_region;
-        q.pop();
-      }
-      else {
-        q.pop();
-        if (never) break;
-      }
-    }
+refcount_type& refcount(const libxstream_argument* registered)
+{
+  LIBXSTREAM_ASSERT(sizeof(refcount_type) <= sizeof(libxstream_argument));
+  return *reinterpret_cast<refcount_type*>(const_cast<libxstream_argument*>(registered - 1));
+}
+
 
-#if defined(LIBXSTREAM_STDFEATURES) || defined(__GNUC__)
-    return queue;
+void acquire(const libxstream_argument* registered)
+{
+  refcount_type& count = refcount(registered);
+#if defined(LIBXSTREAM_STDFEATURES)
+  ++count;
+#elif defined(__GNUC__)
+  __sync_fetch_and_add(&count, 1);
 #else
-    return EXIT_SUCCESS;
+  InterlockedIncrement64(reinterpret_cast<volatile LONG64*>(&count));
 #endif
-  }
+}
+
 
-private:
-  static libxstream_capture_base *const terminator;
-  libxstream_capture_base* m_buffer[LIBXSTREAM_MAX_QSIZE];
-  libxstream_lock* m_lock;
-  size_t m_index;
+// the last reference (registration or work item) releases the signature
+void release(const libxstream_argument* registered)
+{
+  refcount_type& count = refcount(registered);
 #if defined(LIBXSTREAM_STDFEATURES)
-  std::thread m_thread;
-  std::atomic<size_t> m_size;
-  std::atomic<int> m_status;
+  const size_t remaining = --count;
 #elif defined(__GNUC__)
-  pthread_t m_thread;
-  size_t m_size;
-  int m_status;
+  const size_t remaining = __sync_sub_and_fetch(&count, 1);
 #else
-  HANDLE m_thread;
-  size_t m_size;
-  int m_status;
+  const size_t remaining = static_cast<size_t>(InterlockedDecrement64(reinterpret_cast<volatile LONG64*>(&count)));
 #endif
-#if defined(LIBXSTREAM_CAPTURE_DEBUG)
-};
-#else
-} queue;
+  if (0 == remaining) {
+#if defined(LIBXSTREAM_STDFEATURES)
+    count.~refcount_type();
 #endif
-/*static*/ libxstream_capture_base *const queue_type::terminator = reinterpret_cast<libxstream_capture_base*>(-1);
+    delete[] (registered - 1);
+  }
+}
+
+// annotation of the next capture region constructed by this thread
+LIBXSTREAM_TLS const char* label = 0;
+LIBXSTREAM_TLS size_t nbytes = 0;
+LIBXSTREAM_TLS int copy = -1;
 
 } // namespace libxstream_capture_internal
 
 
 libxstream_capture_base::libxstream_capture_base(size_t argc, const arg_type argv[], libxstream_stream* stream, int flags)
-  : m_function(0)
+  : m_signature(m_inline)
+  , m_function(0)
   , m_stream(stream)
   , m_flags(flags)
+  , m_registered(0)
+  , m_replaced(0)
+  , m_arity(0)
+  , m_label(libxstream_capture_internal::label)
+  , m_nbytes(libxstream_capture_internal::nbytes)
+  , m_enqueued(0)
+  , m_copy(libxstream_capture_internal::copy)
 #if defined(LIBXSTREAM_THREADLOCAL_SIGNALS) && defined(LIBXSTREAM_ASYNC) && (0 != (2*LIBXSTREAM_ASYNC+1)/2)
   , m_thread(this_thread_id())
 #endif
@@ -280,32 +158,61 @@ libxstream_capture_base::libxstream_capture_base(size_t argc, const arg_type arg
   , m_unlock(true)
 #endif
 {
+#if !defined(LIBXSTREAM_STREAM_TIMES)
+# if defined(LIBXSTREAM_TIMELINE) && (0 < (LIBXSTREAM_TIMELINE))
+  if (libxstream_timeline::enabled())
+# endif
+#endif
+  {
+    m_enqueued = libxstream_timer_tick();
+  }
+  libxstream_capture_internal::label = 0;
+  libxstream_capture_internal::nbytes = 0;
+  libxstream_capture_internal::copy = -1;
+
   if (2 == argc && (argv[0].signature() || argv[1].signature())) {
-    const libxstream_argument* signature = 0;
+    const call_type* call = 0;
     if (argv[1].signature()) {
       m_function = *reinterpret_cast<const libxstream_function*>(argv + 0);
-      signature = static_cast<const libxstream_argument*>(libxstream_get_value(argv[1]).const_pointer);
+      call = static_cast<const call_type*>(libxstream_get_value(argv[1]).const_pointer);
     }
     else {
       LIBXSTREAM_ASSERT(argv[0].signature());
       m_function = *reinterpret_cast<const libxstream_function*>(argv + 1);
-      signature = static_cast<const libxstream_argument*>(libxstream_get_value(argv[0]).const_pointer);
+      call = static_cast<const call_type*>(libxstream_get_value(argv[0]).const_pointer);
     }
 
-    size_t arity = 0;
+    LIBXSTREAM_ASSERT(0 != call);
+    const libxstream_argument *const signature = call->signature;
     if (signature) {
-      LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_get_arity(signature, &arity));
+      LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_get_arity(signature, &m_arity));
+      reserve(m_arity);
+    }
+    if (signature && call->registered) { // refer to the signature; copy the replaced arguments only
+      LIBXSTREAM_ASSERT(call->nvalues <= m_arity && call->nvalues <= 8 * sizeof(m_replaced));
+      m_registered = signature;
+      libxstream_capture_internal::acquire(signature);
+      for (size_t i = 0; i < call->nvalues; ++i) {
+        if (0 != call->values[i]) {
+          m_signature[i] = signature[i];
+          LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_set_value(m_signature[i], call->values[i]));
+          m_replaced |= 1U << i;
+        }
+      }
+    }
+    else {
 #if defined(__INTEL_COMPILER)
 #     pragma loop_count min(0), max(LIBXSTREAM_MAX_NARGS), avg(LIBXSTREAM_MAX_NARGS/2)
 #endif
-      for (size_t i = 0; i < arity; ++i) m_signature[i] = signature[i];
+      for (size_t i = 0; i < m_arity; ++i) m_signature[i] = signature[i];
+      LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_construct(m_signature, m_arity, libxstream_argument::kind_invalid, 0, LIBXSTREAM_TYPE_INVALID, 0, 0));
     }
-    LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_construct(m_signature, arity, libxstream_argument::kind_invalid, 0, LIBXSTREAM_TYPE_INVALID, 0, 0));
   }
   else {
-    LIBXSTREAM_ASSERT(argc <= (LIBXSTREAM_MAX_NARGS));
+    reserve(argc);
     for (size_t i = 0; i < argc; ++i) m_signature[i] = argv[i];
     LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_construct(m_signature, argc, libxstream_argument::kind_invalid, 0, LIBXSTREAM_TYPE_INVALID, 0, 0));
+    m_arity = argc;
 #if defined(LIBXSTREAM_DEBUG)
     size_t arity = 0;
     LIBXSTREAM_ASSERT(LIBXSTREAM_ERROR_NONE == libxstream_get_arity(m_signature, &arity) && arity == argc);
@@ -316,7 +223,39 @@ libxstream_capture_base::libxstream_capture_base(size_t argc, const arg_type arg
     if (0 == (flags & LIBXSTREAM_CALL_WAIT) && 0 != stream->demux()) {
       stream->lock(0 > stream->demux());
     }
-    stream->begin();
+  }
+}
+
+
+libxstream_capture_base::libxstream_capture_base(const libxstream_capture_base& other)
+  : m_signature(m_inline)
+  , m_function(other.m_function)
+  , m_stream(other.m_stream)
+  , m_flags(other.m_flags)
+  , m_registered(other.m_registered)
+  , m_replaced(other.m_replaced)
+  , m_arity(other.m_arity)
+  , m_label(other.m_label)
+  , m_nbytes(other.m_nbytes)
+  , m_enqueued(other.m_enqueued)
+  , m_copy(other.m_copy)
+#if defined(LIBXSTREAM_THREADLOCAL_SIGNALS) && defined(LIBXSTREAM_ASYNC) && (0 != (2*LIBXSTREAM_ASYNC+1)/2)
+  , m_thread(other.m_thread)
+#endif
+  , m_unlock(other.m_unlock)
+{
+  reserve(m_arity);
+  if (0 == m_registered) { // including the terminating argument
+#if defined(__INTEL_COMPILER)
+#   pragma loop_count min(1), max(LIBXSTREAM_MAX_NARGS+1), avg(LIBXSTREAM_MAX_NARGS/2)
+#endif
+    for (size_t i = 0; i <= m_arity; ++i) m_signature[i] = other.m_signature[i];
+  }
+  else {
+    libxstream_capture_internal::acquire(m_registered);
+    for (size_t i = 0; i < m_arity; ++i) {
+      if (0 != (m_replaced & (1U << i))) m_signature[i] = other.m_signature[i];
+    }
   }
 }
 
@@ -324,18 +263,73 @@ libxstream_capture_base::libxstream_capture_base(size_t argc, const arg_type arg
 libxstream_capture_base::~libxstream_capture_base()
 {
   if (m_unlock && m_stream) {
-    m_stream->end();
+    if (0 == (m_flags & LIBXSTREAM_CALL_WAIT) && 0 > m_stream->demux()) {
+      m_stream->release();
+    }
     if (0 != (m_flags & LIBXSTREAM_CALL_UNLOCK) && 0 != m_stream->demux()) {
       m_stream->unlock();
     }
   }
+  if (0 != m_registered) {
+    libxstream_capture_internal::release(m_registered);
+  }
+  if (m_inline != m_signature) {
+    delete[] m_signature;
+  }
 }
 
 
+/*static*/ const libxstream_argument* libxstream_capture_base::register_signature(const libxstream_argument* signature, size_t arity)
+{
+  // the reference count precedes the arguments (including the terminating argument)
+  libxstream_argument *const block = new libxstream_argument[arity+2], *const registered = block + 1;
+  new (block) libxstream_capture_internal::refcount_type(1); // held by the registration
+  std::copy(signature, signature + arity, registered);
+  LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_construct(registered, arity, libxstream_argument::kind_invalid, 0, LIBXSTREAM_TYPE_INVALID, 0, 0));
+  return registered;
+}
+
+
+/*static*/ void libxstream_capture_base::unregister_signature(const libxstream_argument* registered)
+{
+  libxstream_capture_internal::release(registered);
+}
+
+
+/*static*/ void libxstream_capture_base::annotate(const char* label, size_t nbytes, int copy)
+{
+  libxstream_capture_internal::label = label;
+  libxstream_capture_internal::nbytes = nbytes;
+  libxstream_capture_internal::copy = copy;
+}
+
+
+#if defined(LIBXSTREAM_CAPTURE_ARENA) && (0 < (LIBXSTREAM_CAPTURE_ARENA))
+void* libxstream_capture_base::operator new(size_t size)
+{
+  using namespace libxstream_capture_internal;
+  if (0 == arena) {
+    arena = new libxstream_arena(sizeof(libxstream_capture_base), LIBXSTREAM_CAPTURE_ARENA);
+  }
+  void *const result = arena->allocate(size);
+  if (0 == result) {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+
+
+void libxstream_capture_base::operator delete(void* memory)
+{
+  libxstream_arena::deallocate(memory, libxstream_capture_internal::arena);
+}
+#endif
+
+
 int libxstream_capture_base::status(int code)
 {
 #if !defined(LIBXSTREAM_CAPTURE_DEBUG)
-  return libxstream_capture_internal::queue.status(code);
+  return libxstream_capture_internal::worker(*this).status(code);
 #else
   return code;
 #endif
@@ -366,20 +360,108 @@ libxstream_capture_base* libxstream_capture_base::clone() const
 
 void libxstream_capture_base::operator()()
 {
+#if defined(LIBXSTREAM_TIMELINE) && (0 < (LIBXSTREAM_TIMELINE))
+  const bool recorded = libxstream_timeline::enabled();
+#else
+  const bool recorded = false;
+#endif
+  // time stamps are taken if the region was stamped when enqueued (or for the timeline)
+  const bool timed = 0 != m_enqueued || recorded;
+  const unsigned long long started = timed ? libxstream_timer_tick() : 0;
   virtual_run();
+  const unsigned long long finished = timed ? libxstream_timer_tick() : 0;
+
+  if (m_stream) {
+    m_stream->account(*this, started, finished);
+  }
+  if (recorded) {
+    libxstream_timeline::record(*this, started, finished);
+  }
+}
+
+
+void libxstream_capture_base::reserve(size_t arity)
+{
+  LIBXSTREAM_ASSERT(m_inline == m_signature && (LIBXSTREAM_MAX_NARGS) >= arity);
+  if ((LIBXSTREAM_CAPTURE_NARGS) < arity) {
+    m_signature = new libxstream_argument[arity+1];
+  }
+}
+
+
+libxstream_argument* libxstream_capture_base::arguments(bool copy)
+{
+  if (0 != m_registered) {
+    if (0 == m_replaced && !copy) { // not modified by the call
+      return const_cast<libxstream_argument*>(m_registered);
+    }
+    materialize();
+  }
+  return m_signature;
+}
+
+
+void libxstream_capture_base::materialize()
+{
+  LIBXSTREAM_ASSERT(0 != m_registered);
+  for (size_t i = 0; i < m_arity; ++i) {
+    if (0 == (m_replaced & (1U << i))) m_signature[i] = m_registered[i];
+  }
+  LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_construct(m_signature, m_arity, libxstream_argument::kind_invalid, 0, LIBXSTREAM_TYPE_INVALID, 0, 0));
+  libxstream_capture_internal::release(m_registered); // not referred to anymore
+  m_registered = 0;
+  m_replaced = 0;
+}
+
+
+bool libxstream_capture_base::ready() const
+{
+  return virtual_ready();
+}
+
+
+/*virtual*/ bool libxstream_capture_base::virtual_ready() const
+{
+  return true;
+}
+
+
+size_t libxstream_capture_base::update(const void* from, const void* to)
+{
+  if (0 != m_registered) { // the registered signature is not modified
+    materialize();
+  }
+  size_t arity = 0, result = 0;
+  LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_get_arity(m_signature, &arity));
+  for (size_t i = 0; i < arity; ++i) {
+    libxstream_argument& arg = m_signature[i];
+    if (0 < arg.dims && reinterpret_cast<uintptr_t>(from) == arg.data.pointer) {
+      arg.data.pointer = reinterpret_cast<uintptr_t>(to);
+      ++result;
+    }
+  }
+  return result;
 }
 
 
 int libxstream_enqueue(const libxstream_capture_base& capture_region, bool wait)
 {
+  libxstream_graph *const graph = capture_region.stream() ? capture_region.stream()->graph() : 0;
+  if (0 != graph) { // record rather than execute; cannot wait for recorded work
+    LIBXSTREAM_CHECK_CONDITION(!wait);
+    return graph->record(capture_region);
+  }
+
 #if !defined(LIBXSTREAM_CAPTURE_DEBUG)
+  libxstream_worker& worker = libxstream_capture_internal::worker(capture_region);
 # if defined(LIBXSTREAM_SYNCHRONOUS)
   libxstream_use_sink(&wait);
-  libxstream_capture_internal::queue.push(capture_region, true);
+  const int result = worker.push(capture_region, true);
 # else
-  libxstream_capture_internal::queue.push(capture_region, wait);
+  const int result = worker.push(capture_region, wait);
 # endif
-  return libxstream_capture_internal::queue.status(LIBXSTREAM_ERROR_NONE);
+  LIBXSTREAM_CHECK_ERROR(result);
+  return worker.status(LIBXSTREAM_ERROR_NONE);
 #else
   libxstream_use_sink(&wait);
   libxstream_capture_base *const capture_region_clone = capture_region.clone();
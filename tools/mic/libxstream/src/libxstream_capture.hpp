@@ -112,6 +112,15 @@
 
 struct libxstream_capture_base {
 public:
+  // Signature of a call (libxstream_offload); a registered signature is referred to rather than copied,
+  // and values[i] (if not NULL) replaces the i-th argument of the registered signature for this call.
+  struct call_type {
+    const libxstream_argument* signature;
+    const void *const* values;
+    size_t nvalues;
+    bool registered;
+  };
+
   class arg_type: public libxstream_argument {
   public:
     arg_type(): m_signature(false) {
@@ -121,9 +130,9 @@ public:
       const size_t size = sizeof(void*);
       LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_construct(this, 0, kind_input, &function, LIBXSTREAM_TYPE_VOID, 0, &size));
     }
-    arg_type(const libxstream_argument* signature): m_signature(true) {
-      const size_t size = sizeof(libxstream_argument*);
-      LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_construct(this, 0, kind_input, signature, LIBXSTREAM_TYPE_VOID, 1, &size));
+    arg_type(const call_type* call): m_signature(true) {
+      const size_t size = sizeof(call_type*);
+      LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_construct(this, 0, kind_input, call, LIBXSTREAM_TYPE_VOID, 1, &size));
     }
     template<typename T> arg_type(T arg): m_signature(false) {
       LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_construct(this, 0, kind_input, &arg, libxstream_map_to<T>::type(), 0, 0));
@@ -144,8 +153,16 @@ public:
 
 public:
   libxstream_capture_base(size_t argc, const arg_type argv[], libxstream_stream* stream, int flags);
+  // Copies only the arguments in use (clone).
+  libxstream_capture_base(const libxstream_capture_base& other);
   virtual ~libxstream_capture_base();
 
+#if defined(LIBXSTREAM_CAPTURE_ARENA) && (0 < (LIBXSTREAM_CAPTURE_ARENA))
+  // Clones are allocated from the arena of the producer thread and handed back by the consumer.
+  static void* operator new(size_t size);
+  static void operator delete(void* memory);
+#endif
+
 public:
   template<typename T,size_t i> T& val() {
 #if defined(LIBXSTREAM_DEBUG)
@@ -174,20 +191,67 @@ public:
   int status(int code);
   int thread() const;
 
+  libxstream_stream* stream() const { return m_stream; }
+
+  // Arguments of the call; a registered signature is only copied if arguments were replaced
+  // or if a copy is requested (e.g., since the arguments are translated by an offload).
+  libxstream_argument* arguments(bool copy = false);
+
+  // Label, number of Bytes, and direction (libxstream_memcpy_kind or -1 if no transfer) of the
+  // next capture region constructed by the calling thread (statistics and timeline).
+  static void annotate(const char* label, size_t nbytes, int copy = -1);
+
+  // Annotation and enqueue time stamp; zero if the region has no queueing delay of its own.
+  const char* label() const { return m_label; }
+  size_t nbytes() const { return m_nbytes; }
+  int copy() const { return m_copy; }
+  unsigned long long enqueued() const { return m_enqueued; }
+  void enqueued(unsigned long long tick) { m_enqueued = tick; }
+
   libxstream_capture_base* clone() const;
   void operator()();
 
+  // Tells whether the capture region can be executed (dependencies are fulfilled).
+  // A region which is not ready must wake the worker of its stream once it becomes
+  // ready (see libxstream_worker::latch_type); the worker is not polling the region.
+  bool ready() const;
+
+  // Replace pointer arguments equal to "from"; returns the number of replaced arguments.
+  size_t update(const void* from, const void* to);
+
+  // Copy of the signature referred to by calls (call_type::registered); reference counted by the
+  // registration and the work items referring to it i.e., unregistering defers its release.
+  static const libxstream_argument* register_signature(const libxstream_argument* signature, size_t arity);
+  static void unregister_signature(const libxstream_argument* registered);
+
 private:
   virtual libxstream_capture_base* virtual_clone() const = 0;
   virtual void virtual_run() = 0;
+  virtual bool virtual_ready() const;
+
+private:
+  // Copy the registered signature except for the replaced arguments.
+  void materialize();
+
+  // Provide room for the given number of arguments (and the terminating argument).
+  void reserve(size_t arity);
 
 protected:
-  libxstream_argument m_signature[(LIBXSTREAM_MAX_NARGS)+1];
+  libxstream_argument* m_signature; // inline arguments or heap-backed
   libxstream_function m_function;
   libxstream_stream* m_stream;
   int m_flags;
 
 private:
+  // registered signature (if any) and the replaced arguments (bit mask) held by m_signature
+  const libxstream_argument* m_registered;
+  unsigned int m_replaced;
+  size_t m_arity;
+  libxstream_argument m_inline[(LIBXSTREAM_CAPTURE_NARGS)+1];
+  const char* m_label;
+  size_t m_nbytes;
+  unsigned long long m_enqueued;
+  int m_copy;
 #if defined(LIBXSTREAM_THREADLOCAL_SIGNALS) && defined(LIBXSTREAM_ASYNC) && (0 != (2*LIBXSTREAM_ASYNC+1)/2)
   int m_thread;
 #endif
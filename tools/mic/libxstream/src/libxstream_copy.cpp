@@ -0,0 +1,207 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#include "libxstream_copy.hpp"
+#include "libxstream_worker.hpp"
+
+#include <libxstream_begin.h>
+#include <algorithm>
+#include <cstring>
+#if defined(__SSE2__) && !defined(__MIC__)
+# include <emmintrin.h>
+# define LIBXSTREAM_COPY_SSE2
+#endif
+#include <libxstream_end.h>
+
+#if defined(_OPENMP)
+# include <omp.h>
+#endif
+
+
+namespace libxstream_copy_internal {
+
+// minimum number of Bytes per thread
+const size_t chunk_min = (LIBXSTREAM_MEMCPY_PARALLEL) / 4;
+// granularity of the work per thread (cache line)
+const size_t chunk_align = 64;
+
+
+int nchunks(size_t size)
+{
+#if defined(_OPENMP)
+  if ((LIBXSTREAM_MEMCPY_PARALLEL) <= size) {
+    return static_cast<int>(std::max<size_t>(std::min<size_t>(libxstream_copy_nthreads(), size / chunk_min), 1));
+  }
+#else
+  libxstream_use_sink(&size);
+#endif
+  return 1;
+}
+
+
+size_t chunk_size(size_t size, int nchunks)
+{
+  return ((size / nchunks + chunk_align - 1) / chunk_align) * chunk_align;
+}
+
+
+bool streaming(size_t size)
+{
+#if defined(LIBXSTREAM_MEMCPY_STREAMING) && defined(LIBXSTREAM_COPY_SSE2)
+  return (LIBXSTREAM_MEMCPY_STREAMING) <= size;
+#else
+  libxstream_use_sink(&size);
+  return false;
+#endif
+}
+
+
+void copy(char* dst, const char* src, size_t size, bool nt)
+{
+#if defined(LIBXSTREAM_COPY_SSE2)
+  if (nt) {
+    // non-temporal stores need an aligned destination
+    const size_t head = std::min(size, (16 - reinterpret_cast<uintptr_t>(dst) % 16) % 16);
+    memcpy(dst, src, head);
+    size_t i = head;
+    for (; (i + 64) <= size; i += 64) {
+      const __m128i *const s = reinterpret_cast<const __m128i*>(src + i);
+      __m128i *const d = reinterpret_cast<__m128i*>(dst + i);
+      const __m128i a = _mm_loadu_si128(s + 0), b = _mm_loadu_si128(s + 1);
+      const __m128i c = _mm_loadu_si128(s + 2), e = _mm_loadu_si128(s + 3);
+      _mm_stream_si128(d + 0, a);
+      _mm_stream_si128(d + 1, b);
+      _mm_stream_si128(d + 2, c);
+      _mm_stream_si128(d + 3, e);
+    }
+    memcpy(dst + i, src + i, size - i);
+    _mm_sfence(); // streaming stores are weakly ordered
+  }
+  else
+#else
+  libxstream_use_sink(&nt);
+#endif
+  {
+    memcpy(dst, src, size);
+  }
+}
+
+
+void zero(char* dst, size_t size, bool nt)
+{
+#if defined(LIBXSTREAM_COPY_SSE2)
+  if (nt) {
+    const size_t head = std::min(size, (16 - reinterpret_cast<uintptr_t>(dst) % 16) % 16);
+    memset(dst, 0, head);
+    const __m128i z = _mm_setzero_si128();
+    size_t i = head;
+    for (; (i + 64) <= size; i += 64) {
+      __m128i *const d = reinterpret_cast<__m128i*>(dst + i);
+      _mm_stream_si128(d + 0, z);
+      _mm_stream_si128(d + 1, z);
+      _mm_stream_si128(d + 2, z);
+      _mm_stream_si128(d + 3, z);
+    }
+    memset(dst + i, 0, size - i);
+    _mm_sfence();
+  }
+  else
+#else
+  libxstream_use_sink(&nt);
+#endif
+  {
+    memset(dst, 0, size);
+  }
+}
+
+} // namespace libxstream_copy_internal
+
+
+void libxstream_copy(void* dst, const void* src, size_t size)
+{
+  using namespace libxstream_copy_internal;
+  char *const d = static_cast<char*>(dst);
+  const char *const s = static_cast<const char*>(src);
+  const bool nt = streaming(size);
+  const int n = nchunks(size);
+
+  if (1 < n) {
+    const size_t chunk = chunk_size(size, n);
+#if defined(_OPENMP)
+#   pragma omp parallel for num_threads(n) schedule(static)
+#endif
+    for (int i = 0; i < n; ++i) {
+      const size_t begin = std::min(i * chunk, size), end = std::min(begin + chunk, size);
+      copy(d + begin, s + begin, end - begin, nt);
+    }
+  }
+  else {
+    copy(d, s, size, nt);
+  }
+}
+
+
+int libxstream_copy_nthreads()
+{
+#if defined(_OPENMP)
+  if (0 == omp_in_parallel()) {
+    // the calling thread is one of the active threads (if it executes work)
+    const size_t nactive = std::max<size_t>(libxstream_worker::nactive(), 1);
+    return std::max(static_cast<int>(omp_get_max_threads() / nactive), 1);
+  }
+#endif
+  return 1;
+}
+
+
+void libxstream_zero(void* dst, size_t size)
+{
+  using namespace libxstream_copy_internal;
+  char *const d = static_cast<char*>(dst);
+  const bool nt = streaming(size);
+  const int n = nchunks(size);
+
+  if (1 < n) {
+    const size_t chunk = chunk_size(size, n);
+#if defined(_OPENMP)
+#   pragma omp parallel for num_threads(n) schedule(static)
+#endif
+    for (int i = 0; i < n; ++i) {
+      const size_t begin = std::min(i * chunk, size), end = std::min(begin + chunk, size);
+      zero(d + begin, end - begin, nt);
+    }
+  }
+  else {
+    zero(d, size, nt);
+  }
+}
+
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
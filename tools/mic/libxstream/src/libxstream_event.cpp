@@ -31,6 +31,8 @@
 #if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
 #include "libxstream_event.hpp"
 #include "libxstream_capture.hpp"
+#include "libxstream_worker.hpp"
+#include "libxstream_timeline.hpp"
 
 #include <libxstream_begin.h>
 #include <algorithm>
@@ -44,78 +46,288 @@
 //#define LIBXSTREAM_EVENT_WAIT_PAST
 
 
+namespace libxstream_event_internal {
+
+/**
+ * Capture region which becomes ready once the recorded streams executed
+ * the work enqueued prior to the event i.e., the dependent stream is
+ * not blocking a host thread while waiting. The recorded streams wake
+ * the dependent stream directly (the last one to arrive).
+ */
+class dependency_type: public libxstream_capture_base {
+public:
+  dependency_type(libxstream_stream& stream, size_t capacity)
+    : libxstream_capture_base(0, 0, &stream, LIBXSTREAM_CALL_DEFAULT | LIBXSTREAM_CALL_UNLOCK)
+    , m_entries(0 < capacity ? new entry_type[capacity] : 0)
+    , m_capacity(capacity), m_size(0)
+    , m_armed(false)
+  {}
+
+  // the latch is armed per clone (see virtual_ready)
+  dependency_type(const dependency_type& other)
+    : libxstream_capture_base(other)
+    , m_entries(0 < other.m_size ? new entry_type[other.m_size] : 0)
+    , m_capacity(other.m_size), m_size(other.m_size)
+    , m_armed(false)
+  {
+    std::copy(other.m_entries, other.m_entries + other.m_size, m_entries);
+  }
+
+  ~dependency_type() {
+    delete[] m_entries;
+  }
+
+public:
+  void add(libxstream_stream& stream, size_t ticket) {
+    LIBXSTREAM_ASSERT(m_capacity > m_size);
+    m_entries[m_size].stream = &stream;
+    m_entries[m_size].ticket = ticket;
+    ++m_size;
+  }
+
+  int enqueue() {
+    return libxstream_enqueue(*this, false);
+  }
+
+private:
+  dependency_type* virtual_clone() const {
+    return new dependency_type(*this);
+  }
+
+  bool virtual_ready() const {
+    if (!m_armed) {
+      // register with the predecessors once; each of them arrives when reaching the ticket
+      // such that the readiness is not determined by polling all predecessors
+      m_latch.arm(m_stream->worker(), m_size);
+      for (size_t i = 0; i < m_size; ++i) {
+        libxstream_worker::waiter_type& waiter = m_entries[i].waiter;
+        waiter.latch = &m_latch;
+        waiter.ticket = m_entries[i].ticket;
+        m_entries[i].stream->worker().notify(waiter);
+      }
+      m_armed = true;
+      m_latch.arrive();
+    }
+    return m_latch.ready();
+  }
+
+  void virtual_run() {
+#if defined(LIBXSTREAM_OFFLOAD) && defined(LIBXSTREAM_ASYNC) && (0 != (2*LIBXSTREAM_ASYNC+1)/2)
+    for (size_t i = 0; i < m_size; ++i) {
+      const libxstream_stream *const stream = m_entries[i].stream;
+      const libxstream_signal signal = stream->pending(thread());
+      const int device = stream->device();
+      if (0 != signal && 0 <= device) {
+#       pragma offload_wait target(mic:device) wait(signal)
+      }
+    }
+#endif
+  }
+
+  dependency_type& operator=(const dependency_type& other);
+
+private:
+  struct entry_type {
+    libxstream_stream* stream;
+    size_t ticket;
+    libxstream_worker::waiter_type waiter;
+  }* m_entries;
+  size_t m_capacity, m_size;
+  mutable libxstream_worker::latch_type m_latch;
+  mutable bool m_armed;
+};
+
+
+/**
+ * Host function called once the recorded streams executed the work enqueued prior to the event
+ * (libxstream_event_add_callback). The callback is called by the thread completing the last of
+ * the recorded work i.e., there is no thread polling the event; the callback deletes itself.
+ */
+class callback_type {
+public:
+  callback_type(void (*function)(void*), void* data, size_t capacity)
+    : m_function(function), m_data(data)
+    , m_entries(0 < capacity ? new entry_type[capacity] : 0)
+    , m_capacity(capacity), m_size(0)
+  {}
+
+  ~callback_type() {
+    delete[] m_entries;
+  }
+
+public:
+  void add(libxstream_stream& stream, size_t ticket) {
+    LIBXSTREAM_ASSERT(m_capacity > m_size);
+    m_entries[m_size].stream = &stream;
+    m_entries[m_size].waiter.ticket = ticket;
+    ++m_size;
+  }
+
+  // Register with the recorded streams; this object must not be used afterwards.
+  void arm() {
+    m_latch.arm(fire, this, m_size);
+    for (size_t i = 0; i < m_size; ++i) {
+      libxstream_worker::waiter_type& waiter = m_entries[i].waiter;
+      waiter.latch = &m_latch;
+      m_entries[i].stream->worker().notify(waiter);
+    }
+    // called right away if the recorded work is completed already
+    m_latch.arrive();
+  }
+
+private:
+  callback_type(const callback_type& other);
+  callback_type& operator=(const callback_type& other);
+
+  static void fire(void* callback) {
+    callback_type *const self = static_cast<callback_type*>(callback);
+    self->m_function(self->m_data);
+    delete self;
+  }
+
+private:
+  void (*m_function)(void*);
+  void* m_data;
+  struct entry_type {
+    libxstream_stream* stream;
+    libxstream_worker::waiter_type waiter;
+  }* m_entries;
+  size_t m_capacity, m_size;
+  libxstream_worker::latch_type m_latch;
+};
+
+} // namespace libxstream_event_internal
+
+
 libxstream_event::libxstream_event()
-  : m_expected(0)
+  : m_chunks(0), m_capacity(0), m_expected(0)
 {}
 
 
+libxstream_event::libxstream_event(const libxstream_event& other)
+  : m_chunks(0 < other.m_expected ? new chunk_type(other.m_expected) : 0)
+  , m_capacity(other.m_expected), m_expected(other.m_expected)
+{
+  for (size_t i = 0; i < m_expected; ++i) {
+    m_chunks->slots[i] = other.slot(i);
+  }
+}
+
+
+libxstream_event::~libxstream_event()
+{
+  delete m_chunks;
+}
+
+
 size_t libxstream_event::expected() const
 {
-  LIBXSTREAM_ASSERT((LIBXSTREAM_MAX_NDEVICES * LIBXSTREAM_MAX_NSTREAMS) >= m_expected);
+  LIBXSTREAM_ASSERT(m_capacity >= m_expected);
   return m_expected;
 }
 
 
-int libxstream_event::reset()
-{ 
-  int result = LIBXSTREAM_ERROR_NONE;
+libxstream_event::slot_type& libxstream_event::slot(size_t i) const
+{
+  LIBXSTREAM_ASSERT(i < m_capacity);
+  chunk_type* chunk = m_chunks;
+  while (chunk->capacity <= i) {
+    i -= chunk->capacity;
+    chunk = chunk->next;
+  }
+  return chunk->slots[i];
+}
 
-  LIBXSTREAM_ASYNC_BEGIN(0, -2/*invalid device*/, m_slots, &m_expected)
-  {
+
+int libxstream_event::reset()
+{
 #if defined(LIBXSTREAM_DEBUG)
-    std::fill_n(ptr<slot_type,1>(), LIBXSTREAM_MAX_NDEVICES * LIBXSTREAM_MAX_NSTREAMS, slot_type());
-#endif
-    *ptr<size_t,2>() = 0;
+  for (chunk_type* chunk = m_chunks; 0 != chunk; chunk = chunk->next) {
+    std::fill_n(chunk->slots, chunk->capacity, slot_type());
   }
-  LIBXSTREAM_ASYNC_END(LIBXSTREAM_CALL_DEFAULT | LIBXSTREAM_CALL_UNLOCK, result);
-
-  return result;
+#endif
+  m_expected = 0;
+  return LIBXSTREAM_ERROR_NONE;
 }
 
 
 int libxstream_event::enqueue(libxstream_stream& stream, bool reset)
-{ 
+{
   int result = LIBXSTREAM_ERROR_NONE;
 
-  LIBXSTREAM_ASYNC_BEGIN(stream, m_slots, &m_expected, reset)
-  {
-    slot_type *const slots = ptr<slot_type,0>();
-    size_t& expected = *ptr<size_t,1>();
-    const bool reset = val<bool,2>();
+  // streams execute independently i.e., the slot is assigned in the order of enqueuing
+  if (reset) {
+    result = this->reset();
+    LIBXSTREAM_CHECK_ERROR(result);
+  }
+  if (m_capacity == m_expected) { // append a chunk (existing slots stay in place)
+    chunk_type** tail = &m_chunks;
+    while (0 != *tail) tail = &(*tail)->next;
+    const size_t capacity = 0 < m_capacity ? m_capacity : 4;
+    *tail = new chunk_type(capacity);
+    m_capacity += capacity;
+  }
+  slot_type& slot = this->slot(m_expected);
+  slot = slot_type(stream);
+  ++m_expected;
 
-    if (reset) {
-#if defined(LIBXSTREAM_DEBUG)
-      std::fill_n(slots, LIBXSTREAM_MAX_NDEVICES * LIBXSTREAM_MAX_NSTREAMS, slot_type());
-#endif
-      expected = 0;
+  libxstream_capture_base::annotate("record", 0);
+  LIBXSTREAM_ASYNC_BEGIN(stream, &slot)
+  {
+    slot_type& slot = *ptr<slot_type,0>();
+    // the slot might be already recycled by a subsequent reset
+    if (LIBXSTREAM_ASYNC_STREAM == slot.stream()) {
+      slot.pending(LIBXSTREAM_ASYNC_STREAM->pending(thread()));
     }
-
-#if defined(LIBXSTREAM_DEBUG)
-    LIBXSTREAM_ASSERT((LIBXSTREAM_MAX_NDEVICES * LIBXSTREAM_MAX_NSTREAMS) > expected);
-#endif
-    slot_type& slot = slots[expected];
-    slot = slot_type(thread(), *LIBXSTREAM_ASYNC_STREAM);
-    ++expected;
   }
   LIBXSTREAM_ASYNC_END(LIBXSTREAM_CALL_DEFAULT | LIBXSTREAM_CALL_UNLOCK, result);
 
+  // reached once the stream executed the above work item (and everything before)
+  slot.ticket(stream.worker().ticket());
+
   return result;
 }
 
 
+bool libxstream_event::complete(const libxstream_stream* exclude, bool wait) const
+{
+  for (size_t i = 0; i < m_expected; ++i) {
+    const slot_type& slot = this->slot(i);
+    const libxstream_stream *const stream = slot.stream();
+
+    if (0 != stream && exclude != stream) {
+      const libxstream_worker& worker = stream->worker();
+      if (wait) {
+        worker.wait(slot.ticket());
+      }
+      else if (worker.completed() < slot.ticket()) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+
 int libxstream_event::query(bool& occurred, const libxstream_stream* exclude) const
 {
   int result = LIBXSTREAM_ERROR_NONE;
 
-  LIBXSTREAM_ASYNC_BEGIN(0, -2/*invalid device*/, &occurred, exclude, m_slots, &m_expected)
+  if (!complete(exclude, false)) {
+    occurred = false;
+    return result;
+  }
+
+  libxstream_capture_base::annotate("query", 0);
+  LIBXSTREAM_ASYNC_BEGIN(0, -2/*invalid device*/, &occurred, exclude, this, &m_expected)
   {
     const libxstream_stream *const exclude = ptr<const libxstream_stream,2>();
-    slot_type *const slots = ptr<slot_type,3>();
+    const libxstream_event& event = *ptr<const libxstream_event,3>();
     const size_t expected = *ptr<const size_t,4>();
     bool occurred = true; // everythig "occurred" if nothing is expected
 
     for (size_t i = 0; i < expected; ++i) {
-      slot_type& slot = slots[i];
+      slot_type& slot = event.slot(i);
       const libxstream_signal pending_slot = slot.pending();
       libxstream_stream *const stream = slot.stream();
 
@@ -158,15 +370,18 @@ int libxstream_event::wait(const libxstream_stream* exclude)
 {
   int result = LIBXSTREAM_ERROR_NONE;
 
-  LIBXSTREAM_ASYNC_BEGIN(0, -2/*invalid device*/, exclude, m_slots, &m_expected)
+  complete(exclude, true);
+
+  libxstream_capture_base::annotate("synchronize", 0);
+  LIBXSTREAM_ASYNC_BEGIN(0, -2/*invalid device*/, exclude, this, &m_expected)
   {
     const libxstream_stream *const exclude = ptr<const libxstream_stream,1>();
-    slot_type *const slots = ptr<slot_type,2>();
+    const libxstream_event& event = *ptr<const libxstream_event,2>();
     const size_t expected = *ptr<const size_t,3>();
     size_t completed = 0;
 
     for (size_t i = 0; i < expected; ++i) {
-      slot_type& slot = slots[i];
+      slot_type& slot = event.slot(i);
       libxstream_stream *const stream = slot.stream();
       const libxstream_signal pending_slot = slot.pending();
 
@@ -210,9 +425,39 @@ int libxstream_event::wait(const libxstream_stream* exclude)
 }
 
 
-libxstream_event::slot_type::slot_type(int thread, libxstream_stream& stream)
-  : m_stream(&stream) // no need to lock the stream
-  , m_pending(stream.pending(thread))
-{}
+int libxstream_event::depend(libxstream_stream& stream) const
+{
+  libxstream_capture_base::annotate("wait", 0);
+  libxstream_event_internal::dependency_type dependency(stream, m_expected);
+
+  for (size_t i = 0; i < m_expected; ++i) {
+    const slot_type& slot = this->slot(i);
+    libxstream_stream *const recorded = const_cast<libxstream_stream*>(slot.stream());
+    // work of the same stream is executed in order anyways
+    if (0 != recorded && &stream != recorded) {
+      dependency.add(*recorded, slot.ticket());
+    }
+  }
+
+  return dependency.enqueue();
+}
+
+
+int libxstream_event::callback(void (*function)(void*), void* data) const
+{
+  libxstream_event_internal::callback_type *const callback =
+    new libxstream_event_internal::callback_type(function, data, m_expected);
+
+  for (size_t i = 0; i < m_expected; ++i) {
+    const slot_type& slot = this->slot(i);
+    libxstream_stream *const recorded = const_cast<libxstream_stream*>(slot.stream());
+    if (0 != recorded) {
+      callback->add(*recorded, slot.ticket());
+    }
+  }
+
+  callback->arm();
+  return LIBXSTREAM_ERROR_NONE;
+}
 
 #endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
@@ -39,6 +39,9 @@
 struct libxstream_event {
 public:
   libxstream_event();
+  // Snapshot of the recorded slots (compacted).
+  libxstream_event(const libxstream_event& other);
+  ~libxstream_event();
 
 public:
   // Number of streams the event was recorded for.
@@ -56,18 +59,48 @@ public:
   // Wait for the event to happen.
   int wait(const libxstream_stream* exclude = 0);
 
+  // Let the stream wait for the event to happen (without blocking the caller).
+  int depend(libxstream_stream& stream) const;
+
+  // Call function(data) once the event happened (by the thread completing the recorded work).
+  int callback(void (*function)(void*), void* data) const;
+
 private:
+  // Check or wait (host-side) whether the recorded streams executed the work enqueued prior to the event.
+  bool complete(const libxstream_stream* exclude, bool wait) const;
+
   class slot_type {
     libxstream_stream* m_stream;
     mutable libxstream_signal m_pending;
+    size_t m_ticket;
   public:
-    slot_type(): m_stream(0), m_pending(0) {}
-    slot_type(int thread, libxstream_stream& stream);
+    slot_type(): m_stream(0), m_pending(0), m_ticket(0) {}
+    explicit slot_type(libxstream_stream& stream): m_stream(&stream), m_pending(0), m_ticket(0) {}
     const libxstream_stream* stream() const { return m_stream; }
     libxstream_stream* stream() { return m_stream; }
     libxstream_signal pending() const { return m_pending; }
     void pending(libxstream_signal signal) { m_pending = signal; }
-  } m_slots[LIBXSTREAM_MAX_NDEVICES*LIBXSTREAM_MAX_NSTREAMS];
+    size_t ticket() const { return m_ticket; }
+    void ticket(size_t value) { m_ticket = value; }
+  };
+
+  // slots are never moved (enqueued work refers to its slot); each chunk doubles the capacity
+  struct chunk_type {
+    explicit chunk_type(size_t n): slots(new slot_type[n]), capacity(n), next(0) {}
+    ~chunk_type() { delete[] slots; delete next; }
+    slot_type* slots;
+    size_t capacity;
+    chunk_type* next;
+  };
+
+  slot_type& slot(size_t i) const;
+
+private:
+  libxstream_event& operator=(const libxstream_event& other);
+
+private:
+  chunk_type* m_chunks;
+  size_t m_capacity;
   size_t m_expected;
 };
 
@@ -0,0 +1,311 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#include "libxstream_executor.hpp"
+#include "libxstream_worker.hpp"
+
+#if defined(LIBXSTREAM_ASYNCHOST)
+
+#include <libxstream_begin.h>
+#include <algorithm>
+#if defined(LIBXSTREAM_STDFEATURES)
+# include <thread>
+#elif defined(__GNUC__)
+# include <pthread.h>
+# include <unistd.h>
+#endif
+#include <libxstream_end.h>
+
+
+namespace libxstream_executor_internal {
+
+size_t ncores()
+{
+#if defined(LIBXSTREAM_STDFEATURES)
+  const size_t result = std::thread::hardware_concurrency();
+#elif defined(__GNUC__)
+  const long n = sysconf(_SC_NPROCESSORS_ONLN);
+  const size_t result = 0 < n ? static_cast<size_t>(n) : 0;
+#else
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  const size_t result = info.dwNumberOfProcessors;
+#endif
+  return std::max<size_t>(result, 1);
+}
+
+
+// sequentially consistent: a change of the count is ordered with the preceding stores of the thread (e.g., unscheduling a worker)
+#if defined(LIBXSTREAM_STDFEATURES)
+size_t atomic_load(const std::atomic<size_t>& counter) { return counter.load(); }
+void atomic_add(std::atomic<size_t>& counter, size_t value) { counter.fetch_add(value); }
+#else
+size_t atomic_load(const volatile size_t& counter)
+{
+# if defined(__GNUC__)
+  __sync_synchronize();
+# endif
+  return counter;
+}
+void atomic_add(volatile size_t& counter, size_t value)
+{
+# if defined(__GNUC__)
+  __sync_fetch_and_add(&counter, value);
+# else
+  InterlockedExchangeAdd64(reinterpret_cast<volatile LONG64*>(&counter), static_cast<LONG64>(value));
+# endif
+}
+#endif
+
+} // namespace libxstream_executor_internal
+
+
+/*static*/ libxstream_executor& libxstream_executor::instance()
+{
+  // never destroyed: workers (streams) may outlive any static object
+  static libxstream_executor *const executor = new libxstream_executor(libxstream_topology::instance());
+  return *executor;
+}
+
+
+libxstream_executor::libxstream_executor(const libxstream_topology& topology)
+  : m_threads(0)
+  , m_nthreads(0)
+  , m_domains(new size_t[topology.ndomains()+1])
+  , m_idle(new libxstream_parking[topology.ndomains()])
+  , m_next(0)
+{
+  for (size_t i = 0; i < (LIBXSTREAM_WORKER_NLEVELS); ++i) m_nscheduled[i] = 0;
+  const size_t ndomains = topology.ndomains();
+  // number of threads per domain (at least one)
+  for (size_t d = 0; d < ndomains; ++d) {
+    size_t n = (LIBXSTREAM_ASYNCHOST_NTHREADS) / ndomains + (d < (LIBXSTREAM_ASYNCHOST_NTHREADS) % ndomains ? 1 : 0);
+    if (0 == (LIBXSTREAM_ASYNCHOST_NTHREADS)) {
+      n = 0 < topology.ncpus(d) ? topology.ncpus(d) : (libxstream_executor_internal::ncores() / ndomains);
+    }
+    m_domains[d] = m_nthreads;
+    m_nthreads += std::max<size_t>(n, 1);
+  }
+  m_domains[ndomains] = m_nthreads;
+  m_threads = new thread_type[m_nthreads];
+
+  for (size_t i = 0, d = 0; i < m_nthreads; ++i) {
+    thread_type& thread = m_threads[i];
+    while (m_domains[d+1] <= i) ++d;
+    thread.executor = this;
+    thread.id = i;
+    thread.domain = d;
+    thread.nbypassed = 0;
+#if defined(LIBXSTREAM_STDFEATURES)
+    std::thread(run, &thread).detach();
+#elif defined(__GNUC__)
+    pthread_t handle;
+    pthread_create(&handle, 0, run, &thread);
+    pthread_detach(handle);
+#else
+    CloseHandle(CreateThread(0, 0, run, &thread, 0, 0));
+#endif
+  }
+}
+
+
+void libxstream_executor::schedule(libxstream_worker& worker)
+{
+  // round-robin distribution (within the domain of the worker); idle threads steal from each other
+  const size_t i = m_next++, domain = worker.domain();
+  const size_t ndomains = libxstream_topology::instance().ndomains();
+  const size_t d = domain < ndomains ? domain : (i % ndomains);
+  const size_t begin = m_domains[d], n = m_domains[d+1] - begin;
+  push(m_threads[begin + i % n].deque[worker.level()], worker);
+  // one worker became runnable: waking up a single (parked) thread of the domain suffices
+  m_idle[d].notify_one();
+}
+
+
+#if defined(LIBXSTREAM_STDFEATURES) || defined(__GNUC__)
+/*static*/ void* libxstream_executor::run(void* thread)
+#else
+/*static*/ DWORD WINAPI libxstream_executor::run(_In_ LPVOID thread)
+#endif
+{
+  thread_type& self = *static_cast<thread_type*>(thread);
+  libxstream_topology::instance().bind_thread(self.domain);
+  libxstream_parking& idle = self.executor->m_idle[self.domain];
+  bool busy = false;
+
+  for (;;) {
+    // key is obtained prior to looking for work: a worker scheduled afterwards changes the key
+    const size_t key = idle.key();
+    libxstream_worker *const worker = self.executor->acquire(self);
+
+    if (0 != worker) {
+      if (!busy) {
+        libxstream_worker::active(true);
+        busy = true;
+      }
+      size_t nexecuted = 0;
+      if (worker->execute(LIBXSTREAM_ASYNCHOST_BATCH, nexecuted)) {
+        self.executor->push(self.deque[worker->level()], *worker); // still scheduled
+      }
+    }
+    else { // no scheduled worker (waiting workers are not scheduled until their predecessors arrive)
+      if (busy) {
+        libxstream_worker::active(false);
+        busy = false;
+      }
+      idle.wait(key);
+    }
+  }
+
+#if defined(LIBXSTREAM_STDFEATURES) || defined(__GNUC__)
+  return thread;
+#else
+  return EXIT_SUCCESS;
+#endif
+}
+
+
+libxstream_worker* libxstream_executor::acquire(thread_type& thread)
+{
+  const size_t nlevels = LIBXSTREAM_WORKER_NLEVELS;
+#if defined(LIBXSTREAM_PRIORITY_AGING) && (0 < (LIBXSTREAM_PRIORITY_AGING))
+  // serve the least urgent workers first once they were bypassed too often
+  const bool aging = (LIBXSTREAM_PRIORITY_AGING) <= thread.nbypassed;
+#else
+  const bool aging = false;
+#endif
+
+  for (size_t i = 0; i < nlevels; ++i) {
+    const size_t level = aging ? i : (nlevels - i - 1);
+    libxstream_worker* result = thread.deque[level].pop_front();
+    // steal from the threads of the same domain (memory locality)
+    const size_t begin = m_domains[thread.domain], n = m_domains[thread.domain+1] - begin;
+    for (size_t j = 1; 0 == result && j < n; ++j) {
+      result = m_threads[begin + (thread.id - begin + j) % n].deque[level].pop_back();
+    }
+    if (0 != result) {
+      libxstream_executor_internal::atomic_add(m_nscheduled[level], static_cast<size_t>(-1));
+      thread.nbypassed = pending(level) ? (thread.nbypassed + 1) : 0;
+      return result;
+    }
+  }
+
+  return 0;
+}
+
+
+void libxstream_executor::push(deque_type& deque, libxstream_worker& worker)
+{
+  // counted before the worker is visible: the count is never below the number of workers in the deques
+  libxstream_executor_internal::atomic_add(m_nscheduled[worker.level()], 1);
+  deque.push(worker);
+}
+
+
+bool libxstream_executor::urgent(size_t level) const
+{
+  for (size_t i = level + 1; i < (LIBXSTREAM_WORKER_NLEVELS); ++i) {
+    if (0 != libxstream_executor_internal::atomic_load(m_nscheduled[i])) return true;
+  }
+  return false;
+}
+
+
+bool libxstream_executor::pending(size_t level) const
+{
+  for (size_t i = 0; i < level; ++i) {
+    if (0 != libxstream_executor_internal::atomic_load(m_nscheduled[i])) return true;
+  }
+  return false;
+}
+
+
+libxstream_executor::deque_type::deque_type()
+  : m_buffer(new libxstream_worker*[16]), m_capacity(16)
+  , m_begin(0), m_size(0)
+  , m_lock(libxstream_lock_create())
+{}
+
+
+libxstream_executor::deque_type::~deque_type()
+{
+  libxstream_lock_destroy(m_lock);
+  delete[] m_buffer;
+}
+
+
+void libxstream_executor::deque_type::push(libxstream_worker& worker)
+{
+  libxstream_lock_acquire(m_lock);
+  if (m_capacity == m_size) { // unwrap into a buffer of twice the capacity
+    libxstream_worker* *const buffer = new libxstream_worker*[2*m_capacity];
+    for (size_t i = 0; i < m_size; ++i) {
+      buffer[i] = m_buffer[(m_begin + i) % m_capacity];
+    }
+    delete[] m_buffer;
+    m_buffer = buffer;
+    m_capacity *= 2;
+    m_begin = 0;
+  }
+  m_buffer[(m_begin + m_size) % m_capacity] = &worker;
+  ++m_size;
+  libxstream_lock_release(m_lock);
+}
+
+
+libxstream_worker* libxstream_executor::deque_type::pop_front()
+{
+  libxstream_worker* result = 0;
+  libxstream_lock_acquire(m_lock);
+  if (0 < m_size) {
+    result = m_buffer[m_begin];
+    m_begin = (m_begin + 1) % m_capacity;
+    --m_size;
+  }
+  libxstream_lock_release(m_lock);
+  return result;
+}
+
+
+libxstream_worker* libxstream_executor::deque_type::pop_back()
+{
+  libxstream_worker* result = 0;
+  libxstream_lock_acquire(m_lock);
+  if (0 < m_size) {
+    --m_size;
+    result = m_buffer[(m_begin + m_size) % m_capacity];
+  }
+  libxstream_lock_release(m_lock);
+  return result;
+}
+
+#endif // defined(LIBXSTREAM_ASYNCHOST)
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
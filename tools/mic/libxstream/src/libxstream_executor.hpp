@@ -0,0 +1,142 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#ifndef LIBXSTREAM_EXECUTOR_HPP
+#define LIBXSTREAM_EXECUTOR_HPP
+
+#include "libxstream.hpp"
+
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+
+#include <libxstream_begin.h>
+#if defined(LIBXSTREAM_STDFEATURES)
+# include <atomic>
+#elif !defined(__GNUC__)
+# include <Windows.h>
+#endif
+#include <libxstream_end.h>
+
+#include "libxstream_worker.hpp"
+#include "libxstream_parking.hpp"
+
+
+/**
+ * Pool of host threads executing the scheduled workers (LIBXSTREAM_ASYNCHOST).
+ * Each thread owns a queue of scheduled workers, and idle threads steal workers
+ * from other threads. A worker is scheduled at most once, hence it is executed
+ * by at most one thread at a time (order of work within a stream is preserved).
+ * Workers of a more urgent priority level are executed first (with aging).
+ * There is a group of threads per NUMA domain (libxstream_topology) pinned to the
+ * domain; a worker of a domain is executed (and stolen) by the threads of the domain.
+ */
+struct libxstream_executor {
+public:
+  static libxstream_executor& instance();
+
+public:
+  // Number of host threads executing the workers.
+  size_t nthreads() const { return m_nthreads; }
+
+  // Schedule a worker; the worker must not be scheduled already.
+  void schedule(libxstream_worker& worker);
+
+  // Whether a worker of a more urgent level than the given level is scheduled.
+  bool urgent(size_t level) const;
+
+private:
+  explicit libxstream_executor(const libxstream_topology& topology);
+  libxstream_executor(const libxstream_executor& other);
+  libxstream_executor& operator=(const libxstream_executor& other);
+
+  class deque_type {
+  public:
+    deque_type();
+    ~deque_type();
+  public:
+    void push(libxstream_worker& worker);
+    libxstream_worker* pop_front();
+    libxstream_worker* pop_back();
+  private:
+    deque_type(const deque_type& other);
+    deque_type& operator=(const deque_type& other);
+  private:
+    // grows with the number of workers since a worker is scheduled at most once
+    libxstream_worker** m_buffer;
+    size_t m_capacity, m_begin;
+    volatile size_t m_size;
+    libxstream_lock* m_lock;
+  };
+
+  struct thread_type {
+    libxstream_executor* executor;
+    size_t id, domain;
+    // scheduled workers per priority level
+    deque_type deque[LIBXSTREAM_WORKER_NLEVELS];
+    // number of times less urgent workers were waiting
+    size_t nbypassed;
+  };
+
+#if defined(LIBXSTREAM_STDFEATURES)
+  typedef std::atomic<size_t> counter_type;
+#else
+  typedef volatile size_t counter_type;
+#endif
+
+  // Push a worker into the given deque (counted per priority level).
+  void push(deque_type& deque, libxstream_worker& worker);
+  // Most urgent scheduled worker (own workers first, or stolen); nullptr if there is none.
+  libxstream_worker* acquire(thread_type& thread);
+  // Whether a worker of a less urgent level than the given level is scheduled.
+  bool pending(size_t level) const;
+
+#if defined(LIBXSTREAM_STDFEATURES) || defined(__GNUC__)
+  static void* run(void* thread);
+#else
+  static DWORD WINAPI run(_In_ LPVOID thread);
+#endif
+
+private:
+  thread_type* m_threads;
+  size_t m_nthreads;
+  // threads of domain d are [m_domains[d], m_domains[d+1])
+  size_t* m_domains;
+  // idle threads waiting for scheduled workers (per domain since workers are not stolen across domains)
+  libxstream_parking* m_idle;
+  // number of scheduled workers per priority level
+  counter_type m_nscheduled[LIBXSTREAM_WORKER_NLEVELS];
+#if defined(LIBXSTREAM_STDFEATURES)
+  std::atomic<size_t> m_next;
+#else
+  volatile size_t m_next;
+#endif
+};
+
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#endif // LIBXSTREAM_EXECUTOR_HPP
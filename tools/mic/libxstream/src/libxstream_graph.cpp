@@ -0,0 +1,206 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#include "libxstream_graph.hpp"
+#include "libxstream_capture.hpp"
+#include "libxstream_event.hpp"
+#include "libxstream_timeline.hpp"
+
+#include <libxstream_begin.h>
+#include <algorithm>
+#include <libxstream_end.h>
+
+
+namespace libxstream_graph_internal {
+
+/** Capture region executing a sequence of recorded regions in order. */
+class sequence_type: public libxstream_capture_base {
+public:
+  sequence_type(const libxstream_graph& graph, size_t begin, size_t end)
+    : libxstream_capture_base(0, 0, &graph.stream(), LIBXSTREAM_CALL_DEFAULT | LIBXSTREAM_CALL_UNLOCK)
+    , m_graph(&graph), m_begin(begin), m_end(end)
+  {}
+
+public:
+  int enqueue() {
+    return libxstream_enqueue(*this, false);
+  }
+
+private:
+  sequence_type* virtual_clone() const {
+    return new sequence_type(*this);
+  }
+
+  void virtual_run() {
+    m_graph->execute(m_begin, m_end);
+  }
+
+private:
+  const libxstream_graph* m_graph;
+  size_t m_begin, m_end;
+};
+
+
+template<typename T> void grow(T*& array, size_t size, size_t& capacity)
+{
+  if (size == capacity) {
+    const size_t n = std::max<size_t>(2 * capacity, 16);
+    T *const buffer = new T[n];
+    std::copy(array, array + size, buffer);
+    delete[] array;
+    array = buffer;
+    capacity = n;
+  }
+}
+
+} // namespace libxstream_graph_internal
+
+
+libxstream_graph::libxstream_graph(libxstream_stream& stream)
+  : m_stream(&stream)
+  , m_nodes(0), m_size(0), m_capacity(0)
+  , m_batches(0), m_nbatches(0), m_batch_capacity(0)
+{}
+
+
+libxstream_graph::~libxstream_graph()
+{
+  for (size_t i = 0; i < m_size; ++i) {
+    delete m_nodes[i].region;
+  }
+  for (size_t i = 0; i < m_nbatches; ++i) {
+    delete[] m_batches[i];
+  }
+  delete[] m_nodes;
+  delete[] m_batches;
+}
+
+
+int libxstream_graph::record(const libxstream_capture_base& capture_region)
+{
+  LIBXSTREAM_ASSERT(m_stream == capture_region.stream());
+  node_type node;
+  node.region = capture_region.clone();
+  node.region->enqueued(0); // replayed as part of a sequence (no queueing delay of its own)
+  node.event = 0;
+  node.kind = node_type::kind_region;
+  const int result = append(node);
+  if (LIBXSTREAM_ERROR_NONE != result) {
+    delete node.region;
+  }
+  return result;
+}
+
+
+int libxstream_graph::record_wait(const libxstream_event& event)
+{
+  node_type node;
+  node.region = 0;
+  node.event = const_cast<libxstream_event*>(&event);
+  node.kind = node_type::kind_wait;
+  return append(node);
+}
+
+
+int libxstream_graph::record_event(libxstream_event& event)
+{
+  node_type node;
+  node.region = 0;
+  node.event = &event;
+  node.kind = node_type::kind_record;
+  return append(node);
+}
+
+
+void libxstream_graph::adopt(libxstream_memcpy_desc* batch)
+{
+  libxstream_graph_internal::grow(m_batches, m_nbatches, m_batch_capacity);
+  m_batches[m_nbatches++] = batch;
+}
+
+
+size_t libxstream_graph::update(const void* from, const void* to)
+{
+  size_t result = 0;
+  for (size_t i = 0; i < m_size; ++i) {
+    if (0 != m_nodes[i].region) {
+      result += m_nodes[i].region->update(from, to);
+    }
+  }
+  return result;
+}
+
+
+int libxstream_graph::launch()
+{
+  int result = LIBXSTREAM_ERROR_NONE;
+  size_t begin = 0;
+
+  for (size_t i = 0; i <= m_size; ++i) {
+    if (i == m_size || node_type::kind_region != m_nodes[i].kind) {
+      if (begin < i) { // sequence of regions
+        libxstream_capture_base::annotate("graph", 0);
+        libxstream_graph_internal::sequence_type sequence(*this, begin, i);
+        result = sequence.enqueue();
+        LIBXSTREAM_CHECK_ERROR(result);
+      }
+      if (i < m_size) {
+        result = node_type::kind_wait == m_nodes[i].kind
+          ? m_nodes[i].event->depend(*m_stream)
+          : m_nodes[i].event->enqueue(*m_stream, true);
+        LIBXSTREAM_CHECK_ERROR(result);
+      }
+      begin = i + 1;
+    }
+  }
+
+  return result;
+}
+
+
+void libxstream_graph::execute(size_t begin, size_t end) const
+{
+  LIBXSTREAM_ASSERT(begin <= end && end <= m_size);
+  for (size_t i = begin; i < end; ++i) {
+    LIBXSTREAM_ASSERT(node_type::kind_region == m_nodes[i].kind);
+    (*m_nodes[i].region)();
+  }
+}
+
+
+int libxstream_graph::append(const node_type& node)
+{
+  libxstream_graph_internal::grow(m_nodes, m_size, m_capacity);
+  m_nodes[m_size++] = node;
+  return LIBXSTREAM_ERROR_NONE;
+}
+
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
@@ -0,0 +1,99 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#ifndef LIBXSTREAM_GRAPH_HPP
+#define LIBXSTREAM_GRAPH_HPP
+
+#include "libxstream.hpp"
+
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+
+
+struct libxstream_capture_base;
+
+
+/**
+ * Work recorded from a stream (libxstream_graph_begin/end) which can be launched many times.
+ * The recorded capture regions are executed in order by a single work item per sequence of
+ * regions i.e., launching the graph neither constructs signatures nor clones any region.
+ */
+struct libxstream_graph {
+public:
+  explicit libxstream_graph(libxstream_stream& stream);
+  ~libxstream_graph();
+
+public:
+  // Stream the work was recorded from (and is launched into).
+  libxstream_stream& stream() const { return *m_stream; }
+
+  // Number of recorded nodes.
+  size_t size() const { return m_size; }
+
+  // Record a capture region (the graph owns a clone).
+  int record(const libxstream_capture_base& capture_region);
+  // Record that the stream waits for the event.
+  int record_wait(const libxstream_event& event);
+  // Record the event.
+  int record_event(libxstream_event& event);
+
+  // Keep a buffer (allocated using new[]) as long as the graph exists.
+  void adopt(libxstream_memcpy_desc* batch);
+
+  // Replace pointer arguments of the recorded regions; returns the number of replaced arguments.
+  size_t update(const void* from, const void* to);
+
+  // Enqueue the recorded work into the stream.
+  int launch();
+
+  // Execute the recorded regions [begin, end) (called by the enqueued work).
+  void execute(size_t begin, size_t end) const;
+
+private:
+  libxstream_graph(const libxstream_graph& other);
+  libxstream_graph& operator=(const libxstream_graph& other);
+
+  struct node_type {
+    libxstream_capture_base* region;
+    libxstream_event* event;
+    enum { kind_region, kind_wait, kind_record } kind;
+  };
+
+  int append(const node_type& node);
+
+private:
+  libxstream_stream* m_stream;
+  node_type* m_nodes;
+  size_t m_size, m_capacity;
+  libxstream_memcpy_desc** m_batches;
+  size_t m_nbatches, m_batch_capacity;
+};
+
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#endif // LIBXSTREAM_GRAPH_HPP
@@ -33,11 +33,16 @@
 #include "libxstream_argument.hpp"
 #include "libxstream_capture.hpp"
 #include "libxstream_context.hpp"
+#include "libxstream_timeline.hpp"
 
 #include <libxstream_begin.h>
 #include <algorithm>
 #include <libxstream_end.h>
 
+#if (32 < (LIBXSTREAM_MAX_NARGS))
+# error LIBXSTREAM_MAX_NARGS exceeds the number of arguments a function is called with (libxstream_offload_internal::call)!
+#endif
+
 
 namespace libxstream_offload_internal {
 
@@ -88,6 +93,22 @@ LIBXSTREAM_TARGET(mic) void call(libxstream_function function, libxstream_argume
     case 14: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13]); break;
     case 15: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14]); break;
     case 16: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15]); break;
+    case 17: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16]); break;
+    case 18: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17]); break;
+    case 19: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17], a[18]); break;
+    case 20: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17], a[18], a[19]); break;
+    case 21: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17], a[18], a[19], a[20]); break;
+    case 22: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17], a[18], a[19], a[20], a[21]); break;
+    case 23: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17], a[18], a[19], a[20], a[21], a[22]); break;
+    case 24: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17], a[18], a[19], a[20], a[21], a[22], a[23]); break;
+    case 25: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17], a[18], a[19], a[20], a[21], a[22], a[23], a[24]); break;
+    case 26: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17], a[18], a[19], a[20], a[21], a[22], a[23], a[24], a[25]); break;
+    case 27: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17], a[18], a[19], a[20], a[21], a[22], a[23], a[24], a[25], a[26]); break;
+    case 28: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17], a[18], a[19], a[20], a[21], a[22], a[23], a[24], a[25], a[26], a[27]); break;
+    case 29: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17], a[18], a[19], a[20], a[21], a[22], a[23], a[24], a[25], a[26], a[27], a[28]); break;
+    case 30: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17], a[18], a[19], a[20], a[21], a[22], a[23], a[24], a[25], a[26], a[27], a[28], a[29]); break;
+    case 31: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17], a[18], a[19], a[20], a[21], a[22], a[23], a[24], a[25], a[26], a[27], a[28], a[29], a[30]); break;
+    case 32: function(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17], a[18], a[19], a[20], a[21], a[22], a[23], a[24], a[25], a[26], a[27], a[28], a[29], a[30], a[31]); break;
     default: {
       LIBXSTREAM_ASSERT(false);
     }
@@ -100,21 +121,35 @@ LIBXSTREAM_TARGET(mic) void call(libxstream_function function, libxstream_argume
 #endif
 }
 
-} // namespace libxstream_offload_internal
-
 
-int libxstream_offload(libxstream_function function, const libxstream_argument signature[], libxstream_stream* stream, int flags)
+int offload(libxstream_function function, const libxstream_capture_base::call_type& call, libxstream_stream* stream, int flags)
 {
   LIBXSTREAM_ASSERT(0 == (LIBXSTREAM_CALL_EXTERNAL & flags));
   int result = LIBXSTREAM_ERROR_NONE;
 
-  LIBXSTREAM_ASYNC_BEGIN(stream, function, signature) {
+  size_t nbytes = 0;
+  if (libxstream_timeline::enabled()) { // amount of array data passed to the function
+    const libxstream_argument *const signature = call.signature;
+    size_t arity = 0, size = 0;
+    if (signature && LIBXSTREAM_ERROR_NONE == libxstream_get_arity(signature, &arity)) {
+      for (size_t i = 0; i < arity; ++i) {
+        if (0 < signature[i].dims && LIBXSTREAM_ERROR_NONE == libxstream_get_datasize(signature, i, &size)) nbytes += size;
+      }
+    }
+  }
+  libxstream_capture_base::annotate("call", nbytes);
+  LIBXSTREAM_ASYNC_BEGIN(stream, function, &call) {
     LIBXSTREAM_TARGET(mic) /*const*/ libxstream_function fhybrid = 0 == (m_flags & LIBXSTREAM_CALL_NATIVE) ? m_function : 0;
     const void *const fnative = reinterpret_cast<const void*>(m_function);
-    libxstream_argument *const signature = m_signature;
+#if defined(LIBXSTREAM_OFFLOAD)
+    // arguments are translated when offloaded i.e., a registered signature is copied
+    libxstream_argument *const signature = arguments(0 <= LIBXSTREAM_ASYNC_DEVICE);
+#else
+    libxstream_argument *const signature = arguments();
+#endif
     const int flags = m_flags;
     size_t arity = 0;
-    LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_get_arity(m_signature, &arity));
+    LIBXSTREAM_CHECK_CALL_ASSERT(libxstream_get_arity(signature, &arity));
 
 #if defined(LIBXSTREAM_OFFLOAD)
     if (0 <= LIBXSTREAM_ASYNC_DEVICE) {
@@ -126,13 +161,13 @@ int libxstream_offload(libxstream_function function, const libxstream_argument s
 #     pragma loop_count min(0), max(LIBXSTREAM_MAX_NARGS), avg(LIBXSTREAM_MAX_NARGS/2)
 #endif
       for (size_t i = 0; i < arity; ++i) {
-        if (0 != m_signature[i].dims) {
-          p[np] = static_cast<char*>(libxstream_get_value(m_signature[i]).pointer);
+        if (0 != signature[i].dims) {
+          p[np] = static_cast<char*>(libxstream_get_value(signature[i]).pointer);
           ++np;
         }
-        else if (0 != (libxstream_argument::kind_output & m_signature[i].kind)) {
-          p[np] = static_cast<char*>(libxstream_get_value(m_signature[i]).pointer);
-          s |= ((2 << np) >> 1);
+        else if (0 != (libxstream_argument::kind_output & signature[i].kind)) {
+          p[np] = static_cast<char*>(libxstream_get_value(signature[i]).pointer);
+          s |= 1U << np;
           ++np;
         }
       }
@@ -524,4 +559,74 @@ int libxstream_offload(libxstream_function function, const libxstream_argument s
   return result;
 }
 
+
+// host function along with application-defined data (libxstream_fn_enqueue); the data is owned by the
+// most recent copy of the capture region i.e., by the enqueued (or recorded) clone once it exists
+class callable_type: public libxstream_capture_base {
+public:
+  typedef void (*function_type)(void*);
+
+  callable_type(size_t argc, const arg_type argv[], libxstream_stream* stream, int flags, int& result)
+    : libxstream_capture_base(argc, argv, stream, flags)
+    , m_owner(true)
+  {
+    result = libxstream_enqueue(*this, 0 != (flags & LIBXSTREAM_CALL_WAIT));
+  }
+
+  callable_type(const callable_type& other)
+    : libxstream_capture_base(other)
+    , m_owner(other.m_owner)
+  {
+    other.m_owner = false;
+  }
+
+  ~callable_type() {
+    const function_type destroy = val<function_type,1>();
+    if (m_owner && destroy) {
+      destroy(val<void*,2>());
+    }
+  }
+
+private:
+  callable_type* virtual_clone() const {
+    return new callable_type(*this);
+  }
+
+  void virtual_run() {
+    val<function_type,0>()(val<void*,2>());
+  }
+
+private:
+  mutable bool m_owner;
+};
+
+} // namespace libxstream_offload_internal
+
+
+int libxstream_offload(libxstream_function function, const libxstream_argument signature[], libxstream_stream* stream, int flags)
+{
+  const libxstream_capture_base::call_type call = { signature, 0, 0, false };
+  return libxstream_offload_internal::offload(function, call, stream, flags);
+}
+
+
+int libxstream_offload(libxstream_function function, const libxstream_argument registered[], const void *const values[], size_t nvalues, libxstream_stream* stream, int flags)
+{
+  const libxstream_capture_base::call_type call = { registered, values, nvalues, true };
+  return libxstream_offload_internal::offload(function, call, stream, flags);
+}
+
+
+int libxstream_offload(void (*run)(void*), void (*destroy)(void*), void* data, libxstream_stream* stream, int flags)
+{
+  LIBXSTREAM_ASSERT(0 == (LIBXSTREAM_CALL_EXTERNAL & flags));
+  int result = LIBXSTREAM_ERROR_NONE;
+  const libxstream_capture_base::arg_type argv[] = {
+    reinterpret_cast<uintptr_t>(run), reinterpret_cast<uintptr_t>(destroy), reinterpret_cast<uintptr_t>(data)
+  };
+  libxstream_capture_base::annotate("enqueue", 0);
+  const libxstream_offload_internal::callable_type capture_region(sizeof(argv) / sizeof(*argv), argv, stream, flags, result);
+  return result;
+}
+
 #endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
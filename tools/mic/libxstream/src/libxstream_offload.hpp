@@ -37,6 +37,10 @@
 
 
 int libxstream_offload(libxstream_function function, const libxstream_argument signature[], libxstream_stream* stream, int flags);
+// Refers to a registered signature; values[i] (if not NULL) replaces the i-th argument for this call.
+int libxstream_offload(libxstream_function function, const libxstream_argument registered[], const void *const values[], size_t nvalues, libxstream_stream* stream, int flags);
+// Executes run(data) on the host; the data is owned by the enqueued work (destroy is called once the work is released).
+int libxstream_offload(void (*run)(void*), void (*destroy)(void*), void* data, libxstream_stream* stream, int flags);
 
 #endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
 #endif // LIBXSTREAM_OFFLOAD_HPP
@@ -0,0 +1,276 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#include "libxstream_parking.hpp"
+
+#include <libxstream_begin.h>
+#include <algorithm>
+#include <libxstream_end.h>
+
+
+namespace libxstream_parking_internal {
+
+#if defined(LIBXSTREAM_STDFEATURES)
+typedef std::atomic<unsigned long long> value_type;
+#else
+typedef volatile unsigned long long value_type;
+#endif
+
+
+template<typename T> T atomic_load(const volatile T& value) { return value; }
+template<typename T> void atomic_store(volatile T& value, T update) { value = update; }
+#if defined(LIBXSTREAM_STDFEATURES)
+template<typename T> T atomic_load(const std::atomic<T>& value) { return value.load(std::memory_order_relaxed); }
+template<typename T> void atomic_store(std::atomic<T>& value, T update) { value.store(update, std::memory_order_relaxed); }
+#endif
+
+
+class stats_type {
+public:
+  // no destructor: threads may wait beyond the lifetime of static objects
+  stats_type()
+    : m_spin(0), m_park(0), m_latency(0), m_latency_max(0), m_nparked(0)
+#if !defined(LIBXSTREAM_STDFEATURES) && !defined(__GNUC__)
+    , m_lock(libxstream_lock_create())
+#endif
+  {}
+
+public:
+  void add(unsigned long long spin, unsigned long long park, unsigned long long latency, bool parked) {
+#if defined(LIBXSTREAM_STDFEATURES)
+    m_spin += spin;
+    if (parked) {
+      m_park += park;
+      m_latency += latency;
+      ++m_nparked;
+      unsigned long long latency_max = m_latency_max;
+      while (latency_max < latency && !m_latency_max.compare_exchange_weak(latency_max, latency));
+    }
+#elif defined(__GNUC__)
+    __sync_fetch_and_add(&m_spin, spin);
+    if (parked) {
+      __sync_fetch_and_add(&m_park, park);
+      __sync_fetch_and_add(&m_latency, latency);
+      __sync_fetch_and_add(&m_nparked, 1ULL);
+      unsigned long long latency_max = m_latency_max;
+      while (latency_max < latency) {
+        const unsigned long long previous = __sync_val_compare_and_swap(&m_latency_max, latency_max, latency);
+        if (previous == latency_max) break;
+        latency_max = previous;
+      }
+    }
+#else // generic
+    libxstream_lock_acquire(m_lock);
+    m_spin += spin;
+    if (parked) {
+      m_park += park;
+      m_latency += latency;
+      ++m_nparked;
+      m_latency_max = std::max<unsigned long long>(m_latency_max, latency);
+    }
+    libxstream_lock_release(m_lock);
+#endif
+  }
+
+  void get(libxstream_wait_stats& stats) const {
+    const unsigned long long spin = m_spin, park = m_park, nparked = m_nparked;
+    stats.idle_cpu = 0 < (spin + park) ? (100.0 * spin / (spin + park)) : 0.0;
+    stats.wakeup_latency = 0 < nparked ? (1E-9 * m_latency / nparked) : 0.0;
+    stats.wakeup_latency_max = 1E-9 * m_latency_max;
+    stats.spin_time = 1E-9 * spin;
+    stats.park_time = 1E-9 * park;
+    stats.nparked = static_cast<size_t>(nparked);
+  }
+
+private:
+  value_type m_spin, m_park, m_latency, m_latency_max, m_nparked;
+#if !defined(LIBXSTREAM_STDFEATURES) && !defined(__GNUC__)
+  libxstream_lock* m_lock;
+#endif
+} statistics;
+
+} // namespace libxstream_parking_internal
+
+
+libxstream_parking::libxstream_parking()
+  : m_epoch(0), m_nparked(0)
+  , m_notified(0), m_interval(0)
+{
+#if defined(LIBXSTREAM_STDFEATURES) && defined(LIBXSTREAM_STDFEATURES_THREADX)
+#elif defined(__GNUC__)
+  pthread_mutex_init(&m_mutex, 0);
+  pthread_cond_init(&m_condition, 0);
+#else
+  InitializeCriticalSection(&m_mutex);
+  InitializeConditionVariable(&m_condition);
+#endif
+}
+
+
+libxstream_parking::~libxstream_parking()
+{
+#if defined(LIBXSTREAM_STDFEATURES) && defined(LIBXSTREAM_STDFEATURES_THREADX)
+#elif defined(__GNUC__)
+  pthread_cond_destroy(&m_condition);
+  pthread_mutex_destroy(&m_mutex);
+#else
+  DeleteCriticalSection(&m_mutex);
+#endif
+}
+
+
+size_t libxstream_parking::key() const
+{
+#if defined(LIBXSTREAM_STDFEATURES)
+  return m_epoch.load();
+#else
+# if defined(__GNUC__)
+  __sync_synchronize();
+# endif
+  return m_epoch;
+#endif
+}
+
+
+void libxstream_parking::wait(size_t key)
+{
+  using namespace libxstream_parking_internal;
+  if (key != this->key()) return;
+
+  // spin as long as a notification is expected soon; park early otherwise
+  const unsigned long long limit = 1000ULL * (LIBXSTREAM_WAIT_SPIN_US), minimum = limit / 32;
+  const unsigned long long interval = atomic_load(m_interval);
+  const unsigned long long budget = interval < limit ? std::max(2 * interval, minimum) : minimum;
+  const unsigned long long start = libxstream_timer_tick();
+  unsigned long long now = start;
+
+  while (key == this->key()) {
+    if (budget < (now - start)) break;
+    this_thread_yield();
+    now = libxstream_timer_tick();
+  }
+
+  if (key != this->key()) {
+    learn(now - start);
+    statistics.add(now - start, 0, 0, false);
+    return;
+  }
+
+#if defined(LIBXSTREAM_STDFEATURES) && defined(LIBXSTREAM_STDFEATURES_THREADX)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    ++m_nparked;
+    while (key == this->key()) m_condition.wait(lock);
+    --m_nparked;
+  }
+#elif defined(__GNUC__)
+  pthread_mutex_lock(&m_mutex);
+  ++m_nparked;
+  while (key == this->key()) pthread_cond_wait(&m_condition, &m_mutex);
+  --m_nparked;
+  pthread_mutex_unlock(&m_mutex);
+#else
+  EnterCriticalSection(&m_mutex);
+  ++m_nparked;
+  while (key == m_epoch) SleepConditionVariableCS(&m_condition, &m_mutex, INFINITE);
+  --m_nparked;
+  LeaveCriticalSection(&m_mutex);
+#endif
+
+  const unsigned long long woken = libxstream_timer_tick(), notified = atomic_load(m_notified);
+  learn(woken - start);
+  statistics.add(now - start, woken - now, (now <= notified && notified <= woken) ? (woken - notified) : 0, true);
+}
+
+
+void libxstream_parking::notify()
+{
+  signal(true);
+}
+
+
+void libxstream_parking::notify_one()
+{
+  signal(false);
+}
+
+
+void libxstream_parking::learn(unsigned long long waited)
+{
+  using namespace libxstream_parking_internal;
+  // time until a notification arrives (moving average); learned by the waiting threads only
+  const unsigned long long interval = atomic_load(m_interval);
+  atomic_store(m_interval, 0 < interval ? ((7 * interval + waited) / 8) : waited);
+}
+
+
+void libxstream_parking::signal(bool all)
+{
+  using namespace libxstream_parking_internal;
+#if defined(LIBXSTREAM_STDFEATURES)
+  ++m_epoch;
+  if (0 != m_nparked.load()) {
+    atomic_store(m_notified, libxstream_timer_tick());
+# if defined(LIBXSTREAM_STDFEATURES_THREADX)
+    { std::lock_guard<std::mutex> lock(m_mutex); }
+    if (all) m_condition.notify_all(); else m_condition.notify_one();
+# else
+    pthread_mutex_lock(&m_mutex);
+    if (all) pthread_cond_broadcast(&m_condition); else pthread_cond_signal(&m_condition);
+    pthread_mutex_unlock(&m_mutex);
+# endif
+  }
+#elif defined(__GNUC__)
+  __sync_fetch_and_add(&m_epoch, 1);
+  if (0 != __sync_fetch_and_add(&m_nparked, 0)) {
+    atomic_store(m_notified, libxstream_timer_tick());
+    pthread_mutex_lock(&m_mutex);
+    if (all) pthread_cond_broadcast(&m_condition); else pthread_cond_signal(&m_condition);
+    pthread_mutex_unlock(&m_mutex);
+  }
+#else // generic
+  EnterCriticalSection(&m_mutex);
+  ++m_epoch;
+  if (0 != m_nparked) {
+    atomic_store(m_notified, libxstream_timer_tick());
+    if (all) WakeAllConditionVariable(&m_condition); else WakeConditionVariable(&m_condition);
+  }
+  LeaveCriticalSection(&m_mutex);
+#endif
+}
+
+
+/*static*/ void libxstream_parking::stats(libxstream_wait_stats& stats)
+{
+  libxstream_parking_internal::statistics.get(stats);
+}
+
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
@@ -0,0 +1,114 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#ifndef LIBXSTREAM_PARKING_HPP
+#define LIBXSTREAM_PARKING_HPP
+
+#include "libxstream.hpp"
+
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+
+#include <libxstream_begin.h>
+#if defined(LIBXSTREAM_STDFEATURES)
+# include <atomic>
+#endif
+#if defined(LIBXSTREAM_STDFEATURES) && defined(LIBXSTREAM_STDFEATURES_THREADX)
+# include <condition_variable>
+# include <mutex>
+#elif defined(__GNUC__)
+# include <pthread.h>
+#else
+# include <Windows.h>
+#endif
+#include <libxstream_end.h>
+
+
+/**
+ * Spin-then-park waiting ("event count"): a thread obtains a key, checks its condition,
+ * and waits using the key unless the condition holds. The waiting thread spins for an
+ * adaptive budget (learned by the waiting threads from the recent times until a notification
+ * arrived) and then parks on a condition variable until the next notification.
+ */
+struct libxstream_parking {
+public:
+#if defined(LIBXSTREAM_STDFEATURES)
+  typedef std::atomic<size_t> counter_type;
+#else
+  typedef volatile size_t counter_type;
+#endif
+
+public:
+  libxstream_parking();
+  ~libxstream_parking();
+
+public:
+  // Key to be obtained prior to checking the condition.
+  size_t key() const;
+
+  // Spin-then-park unless there was a notification since obtaining the key.
+  void wait(size_t key);
+
+  // Wake up waiting threads (after the condition was changed).
+  void notify();
+
+  // Wake up the spinning threads but only one of the parked threads e.g., if a single thread can make progress.
+  void notify_one();
+
+public:
+  // Accumulated statistics of all parking objects.
+  static void stats(libxstream_wait_stats& stats);
+
+private:
+  libxstream_parking(const libxstream_parking& other);
+  libxstream_parking& operator=(const libxstream_parking& other);
+
+  void learn(unsigned long long waited);
+  void signal(bool all);
+
+private:
+#if defined(LIBXSTREAM_STDFEATURES) && defined(LIBXSTREAM_STDFEATURES_THREADX)
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+#elif defined(__GNUC__)
+  pthread_mutex_t m_mutex;
+  pthread_cond_t m_condition;
+#else
+  CRITICAL_SECTION m_mutex;
+  CONDITION_VARIABLE m_condition;
+#endif
+  counter_type m_epoch;
+  counter_type m_nparked;
+  // time stamp (nanoseconds) of the last notification of a parked thread, and the learned waiting time
+  volatile unsigned long long m_notified;
+  volatile unsigned long long m_interval;
+};
+
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#endif // LIBXSTREAM_PARKING_HPP
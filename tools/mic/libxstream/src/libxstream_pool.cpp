@@ -0,0 +1,305 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#include "libxstream_pool.hpp"
+#include "libxstream_alloc.hpp"
+
+#include <libxstream_begin.h>
+#include <algorithm>
+#include <new>
+#include <libxstream_end.h>
+
+
+struct libxstream_pool::block_type {
+  const void* m_buffer;
+  size_t m_size;
+  block_type* m_next;
+};
+
+
+namespace libxstream_pool_internal {
+
+const size_t nbins = 4 * 8 * sizeof(size_t);
+const size_t nbuckets = 1024;
+
+
+// size class (bin) of the given size; four classes per power of two (nbins if not cacheable)
+size_t bin(size_t size, size_t& class_size)
+{
+  const size_t minimum = LIBXSTREAM_MAX_SIMD, maximum = ~static_cast<size_t>(0) >> 2;
+  const size_t s = std::max(size, minimum);
+  if (maximum < s) {
+    class_size = size;
+    return nbins;
+  }
+  size_t k = 0, base = 1;
+  while (base < s) { base <<= 1; ++k; }
+  if (base == s) {
+    class_size = s;
+    return 4 * k;
+  }
+  base >>= 1; // base < s < 2 * base
+  const size_t step = base / 4, n = (s - base + step - 1) / step; // 1 <= n <= 4
+  class_size = base + n * step;
+  return 4 * (k - 1) + n;
+}
+
+
+template<typename T> void destroy(T* list)
+{
+  while (0 != list) {
+    T *const next = list->m_next;
+    delete list;
+    list = next;
+  }
+}
+
+
+size_t bucket(const void* buffer)
+{
+  const size_t key = static_cast<size_t>(reinterpret_cast<uintptr_t>(buffer) / (LIBXSTREAM_MAX_SIMD));
+  return (key ^ (key >> 10) ^ (key >> 20)) % nbuckets;
+}
+
+} // namespace libxstream_pool_internal
+
+
+/*static*/ libxstream_pool* libxstream_pool::instance(int device)
+{
+  // never destroyed: buffers can be deallocated beyond the lifetime of static objects
+  static libxstream_pool *const pools = new libxstream_pool[(LIBXSTREAM_MAX_NDEVICES)+1];
+  return (-1 <= device && device < (LIBXSTREAM_MAX_NDEVICES)) ? (pools + device + 1) : 0;
+}
+
+
+libxstream_pool::libxstream_pool()
+  : m_blocks(0)
+  , m_lock(libxstream_lock_create())
+#if defined(LIBXSTREAM_MEM_POOL) && (0 < (LIBXSTREAM_MEM_POOL))
+  , m_limit(LIBXSTREAM_MEM_POOL)
+#else
+  , m_limit(0)
+#endif
+  , m_cached(0), m_cached_max(0), m_nbuffers(0)
+  , m_hits(0), m_misses(0)
+{
+  std::fill_n(m_bins, libxstream_pool_internal::nbins, static_cast<block_type*>(0));
+  std::fill_n(m_buckets, libxstream_pool_internal::nbuckets, static_cast<block_type*>(0));
+}
+
+
+libxstream_pool::~libxstream_pool()
+{
+  using namespace libxstream_pool_internal;
+  // records are released but the cached buffers are not deallocated (see evict)
+  for (size_t i = 0; i < nbins; ++i) destroy(m_bins[i]);
+  for (size_t i = 0; i < nbuckets; ++i) destroy(m_buckets[i]);
+  destroy(m_blocks);
+  libxstream_lock_destroy(m_lock);
+}
+
+
+void* libxstream_pool::acquire(size_t& size, size_t alignment)
+{
+  using namespace libxstream_pool_internal;
+  void* result = 0;
+
+  if (0 < size) {
+    size_t class_size = 0;
+    const size_t i = bin(size, class_size);
+    libxstream_lock_acquire(m_lock);
+    if (i < nbins && class_size <= m_limit) { // larger buffers are never cached
+      const size_t auto_alignment = libxstream_alignment(class_size, alignment);
+      // most recently cached buffers first
+      for (block_type *b = m_bins[i], *prev = 0; 0 != b; prev = b, b = b->m_next) {
+        if (0 == reinterpret_cast<uintptr_t>(b->m_buffer) % auto_alignment) {
+          (prev ? prev->m_next : m_bins[i]) = b->m_next;
+          m_cached -= b->m_size;
+          --m_nbuffers;
+          result = const_cast<void*>(b->m_buffer);
+          // the buffer is tracked again
+          block_type*& head = m_buckets[bucket(result)];
+          b->m_next = head;
+          head = b;
+          break;
+        }
+      }
+      size = class_size;
+    }
+    if (result) {
+      ++m_hits;
+    }
+    else {
+      ++m_misses;
+    }
+    libxstream_lock_release(m_lock);
+  }
+
+  return result;
+}
+
+
+void libxstream_pool::track(const void* buffer, size_t size)
+{
+  using namespace libxstream_pool_internal;
+  if (buffer) {
+    libxstream_lock_acquire(m_lock);
+    block_type *const b = 0 < m_limit ? block(buffer, size) : 0;
+    if (b) {
+      block_type*& head = m_buckets[bucket(buffer)];
+      b->m_next = head;
+      head = b;
+    }
+    libxstream_lock_release(m_lock);
+  }
+}
+
+
+bool libxstream_pool::release(const void* buffer)
+{
+  using namespace libxstream_pool_internal;
+  bool result = false;
+
+  if (buffer) {
+    libxstream_lock_acquire(m_lock);
+    block_type*& head = m_buckets[bucket(buffer)];
+    for (block_type *b = head, *prev = 0; 0 != b; prev = b, b = b->m_next) {
+      if (buffer == b->m_buffer) {
+        (prev ? prev->m_next : head) = b->m_next;
+        size_t class_size = 0;
+        const size_t i = bin(b->m_size, class_size);
+        // only buffers allocated with the size of their class are cached
+        if (i < nbins && class_size == b->m_size && b->m_size <= m_limit && m_cached <= (m_limit - b->m_size)) {
+          block_type*& bin_head = m_bins[i];
+          b->m_next = bin_head;
+          bin_head = b;
+          m_cached += b->m_size;
+          m_cached_max = std::max(m_cached_max, m_cached);
+          ++m_nbuffers;
+          result = true;
+        }
+        else { // high-water mark: the buffer is deallocated
+          b->m_next = m_blocks;
+          m_blocks = b;
+        }
+        break;
+      }
+    }
+    libxstream_lock_release(m_lock);
+  }
+
+  return result;
+}
+
+
+void* libxstream_pool::evict(size_t size)
+{
+  using namespace libxstream_pool_internal;
+  void* result = 0;
+
+  libxstream_lock_acquire(m_lock);
+  if (size < m_cached) {
+    for (size_t i = nbins; 0 < i; --i) {
+      block_type *const b = m_bins[i-1];
+      if (0 != b) {
+        m_bins[i-1] = b->m_next;
+        m_cached -= b->m_size;
+        --m_nbuffers;
+        result = const_cast<void*>(b->m_buffer);
+        b->m_next = m_blocks;
+        m_blocks = b;
+        break;
+      }
+    }
+  }
+  libxstream_lock_release(m_lock);
+
+  return result;
+}
+
+
+size_t libxstream_pool::limit() const
+{
+  libxstream_lock_acquire(m_lock);
+  const size_t result = m_limit;
+  libxstream_lock_release(m_lock);
+  return result;
+}
+
+
+void libxstream_pool::limit(size_t limit)
+{
+  libxstream_lock_acquire(m_lock);
+  m_limit = limit;
+  libxstream_lock_release(m_lock);
+}
+
+
+size_t libxstream_pool::cached() const
+{
+  libxstream_lock_acquire(m_lock);
+  const size_t result = m_cached;
+  libxstream_lock_release(m_lock);
+  return result;
+}
+
+
+void libxstream_pool::stats(libxstream_mem_stats& stats) const
+{
+  libxstream_lock_acquire(m_lock);
+  stats.hits = m_hits;
+  stats.misses = m_misses;
+  stats.cached = m_cached;
+  stats.cached_max = m_cached_max;
+  stats.nbuffers = m_nbuffers;
+  stats.limit = m_limit;
+  libxstream_lock_release(m_lock);
+}
+
+
+libxstream_pool::block_type* libxstream_pool::block(const void* buffer, size_t size)
+{
+  block_type* result = m_blocks;
+  if (result) {
+    m_blocks = result->m_next;
+  }
+  else {
+    result = new (std::nothrow) block_type;
+  }
+  if (result) {
+    result->m_buffer = buffer;
+    result->m_size = size;
+    result->m_next = 0;
+  }
+  return result;
+}
+
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
@@ -0,0 +1,95 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#ifndef LIBXSTREAM_POOL_HPP
+#define LIBXSTREAM_POOL_HPP
+
+#include "libxstream.hpp"
+
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+
+
+/**
+ * Caches deallocated buffers of a device for reuse by later allocations. Buffers are
+ * allocated with the size of a size class (at most 25% larger than requested) such that
+ * a cached buffer serves any request of the same class. The number of cached Bytes is
+ * bounded by a high-water mark (LIBXSTREAM_MEM_POOL); buffers are not actually allocated
+ * or deallocated by the pool (see libxstream_mem_allocate and libxstream_mem_deallocate).
+ */
+struct libxstream_pool {
+public:
+  // Pool of the given device (-1: host); NULL if the device is out of range.
+  static libxstream_pool* instance(int device);
+
+public:
+  libxstream_pool();
+  ~libxstream_pool();
+
+public:
+  // Take a cached buffer (sufficiently aligned) for the requested size; NULL if there is none.
+  // The size is adjusted to the size which is to be allocated (size class) otherwise.
+  void* acquire(size_t& size, size_t alignment);
+
+  // Track a buffer which was allocated using the size of a size class.
+  void track(const void* buffer, size_t size);
+
+  // Cache a tracked buffer; returns false if the buffer is not tracked or if it exceeds the high-water mark.
+  bool release(const void* buffer);
+
+  // Take a cached buffer (largest first) unless at most "size" Bytes are cached; NULL otherwise.
+  void* evict(size_t size);
+
+  // High-water mark i.e., maximum number of Bytes cached.
+  size_t limit() const;
+  void limit(size_t limit);
+
+  // Number of Bytes currently cached.
+  size_t cached() const;
+
+  void stats(libxstream_mem_stats& stats) const;
+
+private:
+  libxstream_pool(const libxstream_pool& other);
+  libxstream_pool& operator=(const libxstream_pool& other);
+
+  struct block_type;
+  block_type* block(const void* buffer, size_t size);
+
+private:
+  block_type* m_bins[4*8*sizeof(size_t)]; // cached buffers per size class
+  block_type* m_buckets[1024]; // tracked buffers which are in use
+  block_type* m_blocks; // unused records
+  libxstream_lock* m_lock;
+  size_t m_limit, m_cached, m_cached_max, m_nbuffers;
+  size_t m_hits, m_misses;
+};
+
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#endif // LIBXSTREAM_POOL_HPP
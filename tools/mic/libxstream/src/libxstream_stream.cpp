@@ -32,6 +32,9 @@
 #include "libxstream_stream.hpp"
 #include "libxstream_capture.hpp"
 #include "libxstream_event.hpp"
+#include "libxstream_graph.hpp"
+#include "libxstream_worker.hpp"
+#include "libxstream_timeline.hpp"
 
 #include <libxstream_begin.h>
 #include <algorithm>
@@ -39,6 +42,8 @@
 #include <cstdio>
 #if defined(LIBXSTREAM_STDFEATURES)
 # include <atomic>
+#elif !defined(__GNUC__)
+# include <Windows.h>
 #endif
 #include <libxstream_end.h>
 
@@ -50,87 +55,149 @@
 
 namespace libxstream_stream_internal {
 
+typedef libxstream_stream::counter_type counter_type;
+
+#if defined(LIBXSTREAM_STDFEATURES)
+unsigned long long relaxed_load(const counter_type& counter) { return counter.load(std::memory_order_relaxed); }
+void relaxed_store(counter_type& counter, unsigned long long value) { counter.store(value, std::memory_order_relaxed); }
+#elif defined(__GNUC__)
+unsigned long long relaxed_load(const counter_type& counter) { return __atomic_load_n(&counter, __ATOMIC_RELAXED); }
+void relaxed_store(counter_type& counter, unsigned long long value) { __atomic_store_n(&counter, value, __ATOMIC_RELAXED); }
+#else
+unsigned long long relaxed_load(const counter_type& counter) { return InterlockedCompareExchange64(reinterpret_cast<volatile LONG64*>(const_cast<counter_type*>(&counter)), 0, 0); }
+void relaxed_store(counter_type& counter, unsigned long long value) { InterlockedExchange64(reinterpret_cast<volatile LONG64*>(&counter), static_cast<LONG64>(value)); }
+#endif
+
+// single writer (the work of a stream is executed by one thread at a time)
+void relaxed_add(counter_type& counter, unsigned long long value) { relaxed_store(counter, relaxed_load(counter) + value); }
+
+
 class registry_type {
+public:
+  // copy of the registered streams (taken under the lock); small copies do not allocate
+  class snapshot_type {
+  public:
+    snapshot_type(): m_streams(m_buffer), m_size(0) {}
+    ~snapshot_type() {
+      if (m_buffer != m_streams) delete[] m_streams;
+    }
+  public:
+    void reserve(size_t capacity) {
+      LIBXSTREAM_ASSERT(0 == m_size);
+      if ((sizeof(m_buffer) / sizeof(*m_buffer)) < capacity) {
+        m_streams = new libxstream_stream*[capacity];
+      }
+    }
+    void push(libxstream_stream* stream) { m_streams[m_size++] = stream; }
+    libxstream_stream* operator[](size_t i) const { return m_streams[i]; }
+    size_t size() const { return m_size; }
+  private:
+    snapshot_type(const snapshot_type& other);
+    snapshot_type& operator=(const snapshot_type& other);
+  private:
+    libxstream_stream* m_buffer[32];
+    libxstream_stream** m_streams;
+    size_t m_size;
+  };
+
 public:
   registry_type()
-    : m_istreams(0)
-#if !defined(LIBXSTREAM_STDFEATURES)
-    , m_lock(libxstream_lock_create())
-#endif
+    : m_lock(libxstream_lock_create())
+    , m_nstreams(0)
   {
-    std::fill_n(m_signals, LIBXSTREAM_MAX_NDEVICES, 0);
-    std::fill_n(m_streams, LIBXSTREAM_MAX_NDEVICES * LIBXSTREAM_MAX_NSTREAMS, static_cast<libxstream_stream*>(0));
+    for (size_t i = 0; i <= LIBXSTREAM_MAX_NDEVICES; ++i) {
+      m_devices[i].signal = 0;
+      m_devices[i].streams = 0;
+      m_devices[i].nstreams = 0;
+    }
   }
 
   ~registry_type() {
-    const size_t n = max_nstreams();
-    for (size_t i = 0; i < n; ++i) {
+    for (size_t i = 0; i <= LIBXSTREAM_MAX_NDEVICES; ++i) {
+      // destroying a stream unregisters the stream
+      while (libxstream_stream *const stream = m_devices[i].streams) {
 #if defined(LIBXSTREAM_DEBUG)
-      if (0 != m_streams[i]) {
-        LIBXSTREAM_PRINT_WARN("dangling stream \"%s\"!", m_streams[i]->name());
-      }
+        LIBXSTREAM_PRINT_WARN("dangling stream \"%s\"!", stream->name());
 #endif
-      libxstream_stream_destroy(m_streams[i]);
+        libxstream_stream_destroy(stream);
+      }
     }
-#if !defined(LIBXSTREAM_STDFEATURES)
     libxstream_lock_destroy(m_lock);
-#endif
   }
 
 public:
-  libxstream_stream** allocate() {
-#if !defined(LIBXSTREAM_STDFEATURES)
+  void add(libxstream_stream& stream) {
+    device_type& device = entry(stream.device());
     libxstream_lock_acquire(m_lock);
-#endif
-    libxstream_stream** i = m_streams + (m_istreams++ % (LIBXSTREAM_MAX_NDEVICES * LIBXSTREAM_MAX_NSTREAMS));
-    while (0 != *i) i = m_streams + (m_istreams++ % (LIBXSTREAM_MAX_NDEVICES * LIBXSTREAM_MAX_NSTREAMS));
-#if !defined(LIBXSTREAM_STDFEATURES)
+    stream.m_prev = 0;
+    stream.m_next = device.streams;
+    if (0 != device.streams) {
+      device.streams->m_prev = &stream;
+    }
+    device.streams = &stream;
+    ++device.nstreams;
+    ++m_nstreams;
     libxstream_lock_release(m_lock);
-#endif
-    return i;
   }
 
-  size_t max_nstreams() const {
-    return std::min<size_t>(m_istreams, LIBXSTREAM_MAX_NDEVICES * LIBXSTREAM_MAX_NSTREAMS);
+  void remove(libxstream_stream& stream) {
+    device_type& device = entry(stream.device());
+    libxstream_lock_acquire(m_lock);
+    LIBXSTREAM_ASSERT(0 < device.nstreams && 0 < m_nstreams);
+    if (0 != stream.m_prev) {
+      stream.m_prev->m_next = stream.m_next;
+    }
+    else {
+      LIBXSTREAM_ASSERT(&stream == device.streams);
+      device.streams = stream.m_next;
+    }
+    if (0 != stream.m_next) {
+      stream.m_next->m_prev = stream.m_prev;
+    }
+    stream.m_prev = 0;
+    stream.m_next = 0;
+    --device.nstreams;
+    --m_nstreams;
+    libxstream_lock_release(m_lock);
   }
 
   size_t nstreams(int device) const {
-    const size_t n = max_nstreams();
-    size_t result = 0;
-    for (size_t i = 0; i < n; ++i) {
-      result += (0 != m_streams[i] && m_streams[i]->device() == device) ? 1 : 0;
-    }
-    return result;
+    return entry(device).nstreams; // snapshot
   }
 
   size_t nstreams() const {
-    const size_t n = max_nstreams();
-    size_t result = 0;
-    for (size_t i = 0; i < n; ++i) {
-      result += 0 != m_streams[i] ? 1 : 0;
-    }
-    return result;
+    return m_nstreams; // snapshot
   }
 
   libxstream_signal& signal(int device) {
-    LIBXSTREAM_ASSERT(-1 <= device && device <= LIBXSTREAM_MAX_NDEVICES);
-    return m_signals[device+1];
+    return entry(device).signal;
   }
 
-  libxstream_stream** streams() {
-    return m_streams;
+  // streams of the given device (or of all devices); O(number of registered streams)
+  void snapshot(snapshot_type& streams, const int* device = 0) {
+    libxstream_lock_acquire(m_lock);
+    streams.reserve(device ? entry(*device).nstreams : m_nstreams);
+    for (size_t i = 0; i <= LIBXSTREAM_MAX_NDEVICES; ++i) {
+      if (0 == device || m_devices + i == &entry(*device)) {
+        for (libxstream_stream* stream = m_devices[i].streams; 0 != stream; stream = stream->m_next) {
+          streams.push(stream);
+        }
+      }
+    }
+    libxstream_lock_release(m_lock);
   }
 
   int enqueue(libxstream_event& event, const libxstream_stream* exclude) {
     LIBXSTREAM_ASSERT(0 == event.expected());
     int result = LIBXSTREAM_ERROR_NONE;
-    const size_t n = max_nstreams();
+    snapshot_type streams;
+    snapshot(streams);
     bool reset = true;
 
-    for (size_t i = 0; i < n; ++i) {
-      libxstream_stream *const stream = m_streams[i];
+    for (size_t i = 0; i < streams.size(); ++i) {
+      libxstream_stream *const stream = streams[i];
 
-      if (stream != exclude) {
+      if (stream != exclude && 0 == stream->graph()) { // not recording
         result = event.enqueue(*stream, reset);
         LIBXSTREAM_CHECK_ERROR(result);
         reset = false;
@@ -144,47 +211,62 @@ public:
   }
 
   int sync(int device) {
-    const size_t n = max_nstreams();
-    for (size_t i = 0; i < n; ++i) {
-      if (libxstream_stream *const stream = m_streams[i]) {
-        const int stream_device = stream->device();
-        if (stream_device == device) {
-          const int result = stream->wait(0);
-          LIBXSTREAM_CHECK_ERROR(result);
-        }
-      }
+    snapshot_type streams;
+    snapshot(streams, &device);
+    for (size_t i = 0; i < streams.size(); ++i) {
+      const int result = streams[i]->wait(0);
+      LIBXSTREAM_CHECK_ERROR(result);
     }
     return LIBXSTREAM_ERROR_NONE;
   }
 
   int sync() {
-    const size_t n = max_nstreams();
-    for (size_t i = 0; i < n; ++i) {
-      if (libxstream_stream *const stream = m_streams[i]) {
-        const int result = stream->wait(0);
-        LIBXSTREAM_CHECK_ERROR(result);
-      }
+    snapshot_type streams;
+    snapshot(streams);
+    for (size_t i = 0; i < streams.size(); ++i) {
+      const int result = streams[i]->wait(0);
+      LIBXSTREAM_CHECK_ERROR(result);
     }
     return LIBXSTREAM_ERROR_NONE;
   }
 
-#if !defined(LIBXSTREAM_STDFEATURES)
   libxstream_lock* lock() { return m_lock; }
-#endif
 
 private:
-  // not necessary to be device-specific due to single-threaded offload
-  libxstream_signal m_signals[LIBXSTREAM_MAX_NDEVICES + 1];
-  libxstream_stream* m_streams[LIBXSTREAM_MAX_NDEVICES*LIBXSTREAM_MAX_NSTREAMS];
-#if defined(LIBXSTREAM_STDFEATURES)
-  std::atomic<size_t> m_istreams;
-#else
-  size_t m_istreams;
+  struct device_type {
+    // not necessary to be device-specific due to single-threaded offload
+    libxstream_signal signal;
+    // list of streams (linked by the streams)
+    libxstream_stream* streams;
+    volatile size_t nstreams;
+  };
+
+  device_type& entry(int device) {
+    LIBXSTREAM_ASSERT(-1 <= device && device < LIBXSTREAM_MAX_NDEVICES);
+    return m_devices[device+1];
+  }
+
+  const device_type& entry(int device) const {
+    LIBXSTREAM_ASSERT(-1 <= device && device < LIBXSTREAM_MAX_NDEVICES);
+    return m_devices[device+1];
+  }
+
+private:
+  device_type m_devices[LIBXSTREAM_MAX_NDEVICES+1];
   libxstream_lock* m_lock;
-#endif
+  volatile size_t m_nstreams;
 } registry;
 
 
+// clamp the priority into the supported range
+int priority(int value)
+{
+  int least = 0, greatest = 0;
+  libxstream_stream::priority_range(least, greatest);
+  return std::max(std::min(value, least), greatest);
+}
+
+
 template<typename A, typename E, typename D>
 bool atomic_compare_exchange(A& atomic, E& expected, D desired)
 {
@@ -239,6 +321,35 @@ T atomic_store(A& atomic, T value)
   return result;
 }
 
+
+/**
+ * Ownership of a stream (demux). The state combines the owning thread and whether the owner
+ * is enqueuing work (active) i.e., an idle owner is known exactly rather than guessed. Threads
+ * waiting for the stream are served in order of arrival (tickets).
+ */
+struct owner_type {
+  owner_type(): m_state(0), m_next(0), m_serving(0) {}
+
+  static int state(int thread, bool active) { return ((thread + 1) << 1) | (active ? 1 : 0); }
+  static int thread(int state) { return (state >> 1) - 1; }
+  static bool active(int state) { return 0 != (state & 1); }
+
+#if defined(LIBXSTREAM_STDFEATURES)
+  std::atomic<int> m_state, m_next, m_serving;
+#else
+  volatile int m_state, m_next, m_serving;
+#endif
+};
+
+
+template<typename A>
+int atomic_fetch_increment(A& atomic)
+{
+  int value = atomic;
+  while (!atomic_compare_exchange(atomic, value, value + 1));
+  return value;
+}
+
 } // namespace libxstream_stream_internal
 
 
@@ -260,26 +371,31 @@ T atomic_store(A& atomic, T value)
 }
 
 
+/*static*/ void libxstream_stream::priority_range(int& least, int& greatest)
+{
+  least = 0;
+  greatest = 1 - (LIBXSTREAM_WORKER_NLEVELS);
+}
+
+
 libxstream_stream::libxstream_stream(int device, int demux, int priority, const char* name)
-#if defined(LIBXSTREAM_STDFEATURES)
-  : m_thread(new std::atomic<int>(-1))
-#else
-  : m_thread(new int(-1))
-#endif
+  : m_owner(new libxstream_stream_internal::owner_type)
+  , m_worker(new libxstream_worker(static_cast<size_t>(-libxstream_stream_internal::priority(priority)), libxstream_topology::domain(device)))
+  , m_graph(0)
+  , m_queue_time(0), m_exec_time(0), m_depth_max(0)
+  , m_prev(0), m_next(0)
 #if !(defined(LIBXSTREAM_THREADLOCAL_SIGNALS) && defined(LIBXSTREAM_ASYNC) && (0 != (2*LIBXSTREAM_ASYNC+1)/2))
   , m_signal(0), m_pending(&m_signal)
-#endif
-#if defined(LIBXSTREAM_LOCK_RETRY) && (0 < (LIBXSTREAM_LOCK_RETRY))
-  , m_begin(0), m_end(0)
 #endif
   , m_demux(demux)
-  , m_device(device), m_priority(priority)
+  , m_device(device), m_priority(libxstream_stream_internal::priority(priority))
 #if defined(LIBXSTREAM_OFFLOAD) && defined(LIBXSTREAM_ASYNC) && (2 == (2*LIBXSTREAM_ASYNC+1)/2)
   , m_handle(0) // lazy creation
   , m_npartitions(0)
 #endif
 {
   libxstream_use_sink(name);
+  for (size_t i = 0; i < 3; ++i) m_nbytes[i] = 0;
 #if defined(LIBXSTREAM_THREADLOCAL_SIGNALS) && defined(LIBXSTREAM_ASYNC) && (0 != (2*LIBXSTREAM_ASYNC+1)/2)
   std::fill_n(m_pending, LIBXSTREAM_MAX_NTHREADS, static_cast<libxstream_signal>(0));
 #endif
@@ -293,24 +409,19 @@ libxstream_stream::libxstream_stream(int device, int demux, int priority, const
     m_name[0] = 0;
   }
 #endif
-  using namespace libxstream_stream_internal;
-  libxstream_stream* *const slot = libxstream_stream_internal::registry.allocate();
-  *slot = this;
+  libxstream_stream_internal::registry.add(*this);
 }
 
 
 libxstream_stream::~libxstream_stream()
 {
-  using namespace libxstream_stream_internal;
-  libxstream_stream* *const end = registry.streams() + registry.max_nstreams();
-  libxstream_stream* *const stream = std::find(registry.streams(), end, this);
-  LIBXSTREAM_ASSERT(stream != end);
-  *stream = 0; // unregister stream
-#if defined(LIBXSTREAM_STDFEATURES)
-  delete static_cast<std::atomic<int>*>(m_thread);
-#else
-  delete static_cast<int*>(m_thread);
-#endif
+  // drain the work (queued into this stream) before tearing down
+  delete m_worker;
+  // unfinished recording
+  delete m_graph;
+
+  libxstream_stream_internal::registry.remove(*this);
+  delete m_owner;
 #if defined(LIBXSTREAM_OFFLOAD) && (0 != LIBXSTREAM_OFFLOAD) && !defined(__MIC__) && defined(LIBXSTREAM_ASYNC) && (2 == (2*LIBXSTREAM_ASYNC+1)/2)
   if (0 != m_handle) {
     _Offload_stream_destroy(m_device, m_handle);
@@ -319,6 +430,47 @@ libxstream_stream::~libxstream_stream()
 }
 
 
+void libxstream_stream::account(const libxstream_capture_base& capture_region, unsigned long long started, unsigned long long finished)
+{
+  using namespace libxstream_stream_internal;
+  const int copy = capture_region.copy();
+  if (0 <= copy && 3 > copy) {
+    relaxed_add(m_nbytes[copy], capture_region.nbytes());
+  }
+  // the executing region is not completed yet (counted as pending)
+  const size_t depth = m_worker->ticket() - m_worker->completed();
+  if (relaxed_load(m_depth_max) < depth) {
+    relaxed_store(m_depth_max, depth);
+  }
+#if defined(LIBXSTREAM_STREAM_TIMES)
+  // regions replayed as part of a graph are timed by the enclosing region
+  const unsigned long long enqueued = capture_region.enqueued();
+  if (0 != enqueued) {
+    relaxed_add(m_queue_time, enqueued < started ? (started - enqueued) : 0);
+    relaxed_add(m_exec_time, started < finished ? (finished - started) : 0);
+  }
+#else
+  libxstream_use_sink(&started);
+  libxstream_use_sink(&finished);
+#endif
+}
+
+
+void libxstream_stream::stats(libxstream_stream_counters& counters) const
+{
+  using namespace libxstream_stream_internal;
+  const size_t completed = m_worker->completed(), enqueued = m_worker->ticket();
+  counters.nenqueued = enqueued;
+  counters.ncompleted = completed;
+  counters.h2d = static_cast<size_t>(relaxed_load(m_nbytes[LIBXSTREAM_MEMCPY_H2D]));
+  counters.d2h = static_cast<size_t>(relaxed_load(m_nbytes[LIBXSTREAM_MEMCPY_D2H]));
+  counters.d2d = static_cast<size_t>(relaxed_load(m_nbytes[LIBXSTREAM_MEMCPY_D2D]));
+  counters.queue_time = 1E-9 * relaxed_load(m_queue_time);
+  counters.exec_time = 1E-9 * relaxed_load(m_exec_time);
+  counters.queue_depth_max = std::max(static_cast<size_t>(relaxed_load(m_depth_max)), enqueued - std::min(completed, enqueued));
+}
+
+
 libxstream_signal libxstream_stream::signal() const
 {
   return ++libxstream_stream_internal::registry.signal(m_device);
@@ -329,6 +481,7 @@ int libxstream_stream::wait(libxstream_signal signal)
 {
   int result = LIBXSTREAM_ERROR_NONE;
 
+  libxstream_capture_base::annotate("sync", 0);
   LIBXSTREAM_ASYNC_BEGIN(this, m_pending, signal)
   {
     libxstream_signal *const pending_signals = ptr<libxstream_signal,0>();
@@ -412,127 +565,79 @@ libxstream_signal libxstream_stream::pending(int thread) const
 
 int libxstream_stream::thread() const
 {
-  LIBXSTREAM_ASSERT(m_thread);
-#if defined(LIBXSTREAM_STDFEATURES)
-  return *static_cast<std::atomic<int>*>(m_thread);
-#else
-  return *static_cast<int*>(m_thread);
-#endif
-}
-
-
-void libxstream_stream::begin()
-{
-#if defined(LIBXSTREAM_LOCK_RETRY) && (0 < (LIBXSTREAM_LOCK_RETRY))
-# if defined(LIBXSTREAM_STREAM_UNLOCK_OWNER)
-  if (thread() == this_thread_id())
-# endif
-  {
-    ++m_begin;
-  }
-#endif
+  LIBXSTREAM_ASSERT(m_owner);
+  return libxstream_stream_internal::owner_type::thread(m_owner->m_state);
 }
 
 
-void libxstream_stream::end()
-{
-#if defined(LIBXSTREAM_LOCK_RETRY) && (0 < (LIBXSTREAM_LOCK_RETRY))
-# if defined(LIBXSTREAM_STREAM_UNLOCK_OWNER)
-  if (thread() == this_thread_id())
-# endif
-  {
-    ++m_end;
-  }
-#endif
-}
-
-
-void libxstream_stream::lock(bool retry)
+void libxstream_stream::lock(bool handover)
 {
+  using namespace libxstream_stream_internal;
+  LIBXSTREAM_ASSERT(m_owner);
+  owner_type& owner = *m_owner;
   const int this_thread = this_thread_id();
-#if defined(LIBXSTREAM_STDFEATURES)
-  std::atomic<int> *const stream_thread = static_cast<std::atomic<int>*>(m_thread);
-#else
-  volatile int *const stream_thread = static_cast<volatile int*>(m_thread);
-#endif
-
-  int lock_thread = *stream_thread;
-  if (this_thread != lock_thread) {
-    int unlocked = -1;
-#if defined(LIBXSTREAM_LOCK_RETRY) && (0 < (LIBXSTREAM_LOCK_RETRY))
-    size_t thread_begin = m_begin, thread_end = m_end, nretry = 0;
-# if defined(LIBXSTREAM_PRINT)
-    size_t delay = 0;
-# endif
-    if (retry) {
-      while (!libxstream_stream_internal::atomic_compare_exchange(*stream_thread, unlocked, this_thread)) {
-        static /*const*/ size_t sleep_ms = (LIBXSTREAM_WAIT_LOCK_MS) / (LIBXSTREAM_LOCK_RETRY);
-
-        if ((LIBXSTREAM_LOCK_RETRY) > nretry || m_begin != m_end) {
-          nretry += (thread_begin == m_begin && thread_end == m_end) ? 1 : 0;
-          if (0 < sleep_ms) {
-            this_thread_sleep(sleep_ms);
-          }
-          else {
-            this_thread_yield();
-          }
-          thread_begin = m_begin;
-          thread_end = m_end;
-          unlocked = -1;
-        }
-        else {
-          unlocked = lock_thread != *stream_thread ? -1 : lock_thread;
-          lock_thread = *stream_thread;
-# if defined(LIBXSTREAM_PRINT)
-          delay += nretry * sleep_ms;
-# endif
-          nretry = 0;
-        }
-      }
 
-      if (-1 != unlocked) {
-# if defined(LIBXSTREAM_PRINT)
-        LIBXSTREAM_PRINT_WARN("libxstream_stream_unlock: stream=0x%llx released by thread=%i with delay=%lu ms",
-          reinterpret_cast<unsigned long long>(this), this_thread, static_cast<unsigned long>(delay));
-# else
-        LIBXSTREAM_PRINT_WARN("libxstream_stream_unlock: stream=0x%llx released by thread=%i",
-          reinterpret_cast<unsigned long long>(this), this_thread);
-# endif
+  if (handover) {
+    const int active = owner_type::state(this_thread, true);
+    int state = owner.m_state;
+    // an idle stream is acquired immediately unless other threads are waiting already
+    if (owner.m_next != owner.m_serving || owner_type::active(state) || !atomic_compare_exchange(owner.m_state, state, active)) {
+      const int ticket = atomic_fetch_increment(owner.m_next);
+      while (ticket != owner.m_serving) {
+        this_thread_yield();
       }
-
-      m_begin = 0;
-      m_end = 0;
-    }
-    else
-#endif
-    {
-      while (!libxstream_stream_internal::atomic_compare_exchange(*stream_thread, unlocked, this_thread)) {
+      // the owner (if any) is handing over as soon as it stops enqueuing
+      for (state = owner.m_state; owner_type::active(state) || !atomic_compare_exchange(owner.m_state, state, active); state = owner.m_state) {
         this_thread_yield();
-        unlocked = -1;
       }
+      atomic_store(owner.m_serving, ticket + 1);
+    }
+    if (0 != state && owner_type::thread(state) != this_thread) {
+      LIBXSTREAM_PRINT_INFO("libxstream_stream_lock: stream=0x%llx handed over from thread=%i to thread=%i",
+        reinterpret_cast<unsigned long long>(this), owner_type::thread(state), this_thread);
+    }
+  }
+  else if (this_thread != owner_type::thread(owner.m_state)) {
+    const int locked = owner_type::state(this_thread, false);
+    int unlocked = 0;
+    while (!atomic_compare_exchange(owner.m_state, unlocked, locked)) {
+      this_thread_yield();
+      unlocked = 0;
     }
-
-    LIBXSTREAM_ASSERT(this_thread == *stream_thread);
     LIBXSTREAM_PRINT_INFO("libxstream_stream_lock: stream=0x%llx acquired by thread=%i",
       reinterpret_cast<unsigned long long>(this), this_thread);
   }
 }
 
 
+void libxstream_stream::release()
+{
+  using namespace libxstream_stream_internal;
+  LIBXSTREAM_ASSERT(m_owner && owner_type::active(m_owner->m_state));
+  // only the active owner modifies an active state
+  atomic_store(m_owner->m_state, m_owner->m_state & ~1);
+}
+
+
 void libxstream_stream::unlock()
 {
-#if defined(LIBXSTREAM_STDFEATURES)
-  std::atomic<int> *const stream_thread = static_cast<std::atomic<int>*>(m_thread);
-#else
-  volatile int *const stream_thread = static_cast<volatile int*>(m_thread);
-#endif
+  using namespace libxstream_stream_internal;
+  LIBXSTREAM_ASSERT(m_owner);
+  owner_type& owner = *m_owner;
+  bool released = false;
 
+  // an owner which is enqueuing keeps the stream (handed over afterwards if another thread is waiting)
+  for (int state = owner.m_state; 0 != state && !owner_type::active(state);) {
 #if defined(LIBXSTREAM_STREAM_UNLOCK_OWNER)
-  int locked = this_thread_id();
-  if (libxstream_stream_internal::atomic_compare_exchange(*stream_thread, locked, -1)) {
-#else
-  if (libxstream_stream_internal::atomic_store(*stream_thread, -1)) {
+    if (this_thread_id() != owner_type::thread(state)) break;
 #endif
+    if (atomic_compare_exchange(owner.m_state, state, 0)) {
+      released = true;
+      break;
+    }
+  }
+
+  if (released) {
     LIBXSTREAM_PRINT_INFO("libxstream_stream_unlock: stream=0x%llx released by thread=%i",
       reinterpret_cast<unsigned long long>(this), this_thread_id());
   }
@@ -36,14 +36,30 @@
 #if defined(LIBXSTREAM_OFFLOAD) && (0 != LIBXSTREAM_OFFLOAD)
 # include <offload.h>
 #endif
+#if defined(LIBXSTREAM_STDFEATURES)
+# include <libxstream_begin.h>
+# include <atomic>
+# include <libxstream_end.h>
+#endif
 
 #if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
 
 
 struct libxstream_event;
+struct libxstream_worker;
+struct libxstream_capture_base;
+struct libxstream_graph;
+namespace libxstream_stream_internal { class registry_type; struct owner_type; }
 
 
 struct libxstream_stream {
+public:
+#if defined(LIBXSTREAM_STDFEATURES)
+  typedef std::atomic<unsigned long long> counter_type;
+#else
+  typedef volatile unsigned long long counter_type;
+#endif
+
 public:
   static int enqueue(libxstream_event& event, const libxstream_stream* exclude = 0);
 
@@ -54,7 +70,7 @@ public:
   libxstream_stream(int device,
     /**
      * Controls "demuxing" threads and streams i.e., when multiple threads are queuing into the same stream.
-     * demux<0: automatic (LIBXSTREAM guesses locks incl. deadlock resolution using LIBXSTREAM_LOCK_RETRY)
+     * demux<0: automatic (the stream is handed over to a waiting thread as soon as the owner is not enqueuing)
      * demux=0: disabled  (application is supposed to call libxstream_stream_lock/libxstream_stream_unlock)
      * demux>0: enabled   (application is supposed to use correct stream synchronization)
      */
@@ -66,6 +82,20 @@ public:
   int demux() const       { return m_demux; }
   int device() const      { return m_device; }
   int priority() const    { return m_priority; }
+  // Range of priorities (least priority is the default).
+  static void priority_range(int& least, int& greatest);
+
+  // Worker executing the work enqueued into this stream (in order).
+  libxstream_worker& worker() const { return *m_worker; }
+
+  // Graph recording the work enqueued into this stream (libxstream_graph_begin); NULL if not recording.
+  libxstream_graph* graph() const { return m_graph; }
+  void graph(libxstream_graph* graph) { m_graph = graph; }
+
+  // Account an executed capture region; called by the (single) thread executing the stream's work.
+  void account(const libxstream_capture_base& capture_region, unsigned long long started, unsigned long long finished);
+  // Counters accumulated since the stream was created (libxstream_stream_stats).
+  void stats(libxstream_stream_counters& counters) const;
 
   libxstream_signal signal() const;
   int wait(libxstream_signal signal);
@@ -73,11 +103,13 @@ public:
   void pending(int thread, libxstream_signal signal);
   libxstream_signal pending(int thread) const;
 
+  // Thread owning the stream (-1 if not owned).
   int thread() const;
-  void begin();
-  void end();
 
-  void lock(bool retry);
+  // Acquire the stream; with handover (demux<0), the calling thread is enqueuing until release.
+  void lock(bool handover);
+  // The owner is not enqueuing anymore (demux<0) but keeps the stream unless another thread is waiting.
+  void release();
   void unlock();
 
 #if defined(LIBXSTREAM_OFFLOAD) && (0 != LIBXSTREAM_OFFLOAD) && defined(LIBXSTREAM_ASYNC) && (2 == (2*LIBXSTREAM_ASYNC+1)/2)
@@ -91,6 +123,7 @@ public:
 private:
   libxstream_stream(const libxstream_stream& other);
   libxstream_stream& operator=(const libxstream_stream& other);
+  friend class libxstream_stream_internal::registry_type;
 
 private:
 #if defined(LIBXSTREAM_THREADLOCAL_SIGNALS) && defined(LIBXSTREAM_ASYNC) && (0 != (2*LIBXSTREAM_ASYNC+1)/2)
@@ -99,12 +132,16 @@ private:
 #if defined(LIBXSTREAM_PRINT)
   char m_name[128];
 #endif
-  void* m_thread;
+  libxstream_stream_internal::owner_type* m_owner;
+  libxstream_worker* m_worker;
+  libxstream_graph* m_graph;
+  // counters written by the thread executing the work (see account) but read by any thread (relaxed)
+  counter_type m_queue_time, m_exec_time;
+  counter_type m_nbytes[3], m_depth_max;
+  // streams of the same device (registry)
+  libxstream_stream *m_prev, *m_next;
 #if !(defined(LIBXSTREAM_THREADLOCAL_SIGNALS) && defined(LIBXSTREAM_ASYNC) && (0 != (2*LIBXSTREAM_ASYNC+1)/2))
   libxstream_signal m_signal, *const m_pending;
-#endif
-#if defined(LIBXSTREAM_LOCK_RETRY) && (0 < (LIBXSTREAM_LOCK_RETRY))
-  size_t m_begin, m_end;
 #endif
   int m_demux;
   int m_device;
@@ -0,0 +1,319 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#include "libxstream_timeline.hpp"
+#include "libxstream_capture.hpp"
+#include "libxstream_stream.hpp"
+
+#include <libxstream_begin.h>
+#include <algorithm>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#if defined(LIBXSTREAM_STDFEATURES)
+# include <atomic>
+#endif
+#include <libxstream_end.h>
+
+
+namespace libxstream_timeline_internal {
+
+#if defined(LIBXSTREAM_TIMELINE) && (0 < (LIBXSTREAM_TIMELINE))
+
+#if defined(LIBXSTREAM_STDFEATURES)
+typedef std::atomic<size_t> counter_type;
+#else
+typedef volatile size_t counter_type;
+#endif
+
+
+struct record_type {
+  unsigned long long enqueued, started, finished;
+  const libxstream_stream* stream;
+  const char* label;
+  size_t nbytes;
+  int device, thread;
+  // position in the ring plus one (zero while the record is written)
+  counter_type sequence;
+};
+
+
+size_t fetch_increment(counter_type& counter)
+{
+#if defined(LIBXSTREAM_STDFEATURES)
+  return counter++;
+#elif defined(__GNUC__)
+  return __sync_fetch_and_add(&counter, 1);
+#else
+  size_t result = 0;
+# if defined(_OPENMP)
+# pragma omp critical
+# endif
+  result = counter++;
+  return result;
+#endif
+}
+
+
+void store(counter_type& counter, size_t value)
+{
+#if defined(LIBXSTREAM_STDFEATURES)
+  counter.store(value, std::memory_order_release);
+#else
+# if defined(__GNUC__)
+  __sync_synchronize();
+# endif
+  counter = value;
+#endif
+}
+
+
+size_t load(const counter_type& counter)
+{
+#if defined(LIBXSTREAM_STDFEATURES)
+  return counter.load(std::memory_order_acquire);
+#else
+  const size_t result = counter;
+# if defined(__GNUC__)
+  __sync_synchronize();
+# endif
+  return result;
+#endif
+}
+
+
+class timeline_type {
+public:
+  timeline_type()
+    : m_lock(libxstream_lock_create())
+    , m_records(0), m_next(0)
+    , m_enabled(false)
+  {
+    m_filename[0] = 0;
+    // recording can be enabled without changing the application
+    const char *const filename = getenv("LIBXSTREAM_TIMELINE");
+    if (filename && 0 != *filename) {
+      enable(filename);
+    }
+  }
+
+  // no destructor: capture regions can be recorded beyond the lifetime of static objects
+
+public:
+  bool enabled() const { return m_enabled; }
+
+  void enable(const char* filename) {
+    libxstream_lock_acquire(m_lock);
+    if (0 == m_records) {
+      m_records = new record_type[LIBXSTREAM_TIMELINE]();
+    }
+    if (filename) { // otherwise a previously given file is kept
+      const size_t length = std::min(std::char_traits<char>::length(filename), sizeof(m_filename) - 1);
+      std::copy(filename, filename + length, m_filename);
+      m_filename[length] = 0;
+    }
+    m_enabled = true;
+    libxstream_lock_release(m_lock);
+  }
+
+  void disable() {
+    m_enabled = false;
+  }
+
+  void record(const libxstream_capture_base& capture_region, unsigned long long started, unsigned long long finished) {
+    LIBXSTREAM_ASSERT(0 != m_records);
+    const size_t position = fetch_increment(m_next);
+    record_type& r = m_records[position % (LIBXSTREAM_TIMELINE)];
+    store(r.sequence, 0);
+    const libxstream_stream *const stream = capture_region.stream();
+    r.enqueued = capture_region.enqueued();
+    r.started = started;
+    r.finished = finished;
+    r.stream = stream;
+    r.label = capture_region.label();
+    r.nbytes = capture_region.nbytes();
+    r.device = stream ? stream->device() : -1;
+    r.thread = this_thread_id();
+    store(r.sequence, position + 1);
+  }
+
+  int write(const char* filename) const;
+
+  // file given when enabling the timeline (written at shutdown)
+  const char* filename() const { return m_filename; }
+
+private:
+  libxstream_lock* m_lock;
+  record_type* m_records;
+  counter_type m_next;
+  volatile bool m_enabled;
+  char m_filename[1024];
+};
+
+
+timeline_type& timeline()
+{
+  static timeline_type *const instance = new timeline_type;
+  return *instance;
+}
+
+
+// writes the timeline at shutdown (if a file was given)
+struct exporter_type {
+  exporter_type() { timeline(); }
+  ~exporter_type() {
+    const timeline_type& t = timeline();
+    if (0 != *t.filename()) {
+      t.write(t.filename());
+    }
+  }
+} exporter;
+
+
+int timeline_type::write(const char* filename) const
+{
+  LIBXSTREAM_CHECK_CONDITION(0 != filename && 0 != m_records);
+  FILE *const file = fopen(filename, "w");
+  LIBXSTREAM_CHECK_CONDITION(0 != file);
+
+  // the most recent records which are not overwritten
+  const size_t next = load(m_next), capacity = LIBXSTREAM_TIMELINE;
+  const size_t begin = capacity < next ? (next - capacity) : 0;
+  const size_t size = next - begin;
+  record_type *const records = 0 < size ? new record_type[size] : 0;
+  const libxstream_stream** streams = 0 < size ? new const libxstream_stream*[size] : 0;
+  size_t nrecords = 0, nstreams = 0;
+  unsigned long long origin = ~0ULL;
+
+  for (size_t i = begin; i < next; ++i) {
+    const record_type& r = m_records[i % capacity];
+    if (i + 1 != load(r.sequence)) continue; // not written yet or overwritten
+    record_type& c = records[nrecords];
+    c.enqueued = r.enqueued; c.started = r.started; c.finished = r.finished;
+    c.stream = r.stream; c.label = r.label; c.nbytes = r.nbytes;
+    c.device = r.device; c.thread = r.thread;
+    if (i + 1 != load(r.sequence)) continue; // overwritten while copying
+    origin = std::min(origin, 0 != c.enqueued ? std::min(c.enqueued, c.started) : c.started);
+    ++nrecords;
+  }
+
+  // one track per stream (tid) and per device (pid)
+  fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  for (size_t i = 0; i < nrecords; ++i) {
+    const record_type& r = records[i];
+    const size_t lane = static_cast<size_t>(std::find(streams, streams + nstreams, r.stream) - streams);
+    if (nstreams == lane) {
+      streams[nstreams++] = r.stream;
+      if (r.stream) {
+        fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%i,\"tid\":%lu,\"args\":{\"name\":\"stream 0x%llx\"}},\n",
+          r.device + 1, static_cast<unsigned long>(lane), reinterpret_cast<unsigned long long>(r.stream));
+      }
+      else {
+        fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%i,\"tid\":%lu,\"args\":{\"name\":\"no stream\"}},\n",
+          r.device + 1, static_cast<unsigned long>(lane));
+      }
+    }
+    const char *const label = r.label ? r.label : "region";
+    const double started = 1E-3 * (r.started - origin), finished = 1E-3 * (r.finished - origin);
+    fprintf(file, "{\"name\":\"%s\",\"cat\":\"region\",\"ph\":\"X\",\"pid\":%i,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f,"
+      "\"args\":{\"bytes\":%lu,\"thread\":%i}},\n", label, r.device + 1, static_cast<unsigned long>(lane),
+      started, finished - started, static_cast<unsigned long>(r.nbytes), r.thread);
+    if (0 != r.enqueued && r.enqueued < r.started) { // queueing delay (asynchronous slices may overlap)
+      const double enqueued = 1E-3 * (r.enqueued - origin);
+      fprintf(file, "{\"name\":\"%s\",\"cat\":\"queued\",\"ph\":\"b\",\"id\":%lu,\"pid\":%i,\"tid\":%lu,\"ts\":%.3f},\n",
+        label, static_cast<unsigned long>(i), r.device + 1, static_cast<unsigned long>(lane), enqueued);
+      fprintf(file, "{\"name\":\"%s\",\"cat\":\"queued\",\"ph\":\"e\",\"id\":%lu,\"pid\":%i,\"tid\":%lu,\"ts\":%.3f},\n",
+        label, static_cast<unsigned long>(i), r.device + 1, static_cast<unsigned long>(lane), started);
+    }
+  }
+  fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"host\"}}\n]}\n");
+
+  delete[] streams;
+  delete[] records;
+  return 0 == fclose(file) ? LIBXSTREAM_ERROR_NONE : LIBXSTREAM_ERROR_RUNTIME;
+}
+
+#endif // defined(LIBXSTREAM_TIMELINE) && (0 < (LIBXSTREAM_TIMELINE))
+
+} // namespace libxstream_timeline_internal
+
+
+/*static*/ bool libxstream_timeline::enabled()
+{
+#if defined(LIBXSTREAM_TIMELINE) && (0 < (LIBXSTREAM_TIMELINE))
+  return libxstream_timeline_internal::timeline().enabled();
+#else
+  return false;
+#endif
+}
+
+
+/*static*/ void libxstream_timeline::enable(const char* filename)
+{
+#if defined(LIBXSTREAM_TIMELINE) && (0 < (LIBXSTREAM_TIMELINE))
+  libxstream_timeline_internal::timeline().enable(filename);
+#else
+  libxstream_use_sink(filename);
+#endif
+}
+
+
+/*static*/ void libxstream_timeline::disable()
+{
+#if defined(LIBXSTREAM_TIMELINE) && (0 < (LIBXSTREAM_TIMELINE))
+  libxstream_timeline_internal::timeline().disable();
+#endif
+}
+
+
+/*static*/ void libxstream_timeline::record(const libxstream_capture_base& capture_region, unsigned long long started, unsigned long long finished)
+{
+#if defined(LIBXSTREAM_TIMELINE) && (0 < (LIBXSTREAM_TIMELINE))
+  libxstream_timeline_internal::timeline().record(capture_region, started, finished);
+#else
+  libxstream_use_sink(&capture_region);
+  libxstream_use_sink(&started);
+  libxstream_use_sink(&finished);
+#endif
+}
+
+
+/*static*/ int libxstream_timeline::write(const char* filename)
+{
+#if defined(LIBXSTREAM_TIMELINE) && (0 < (LIBXSTREAM_TIMELINE))
+  return libxstream_timeline_internal::timeline().write(filename);
+#else
+  libxstream_use_sink(filename);
+  return LIBXSTREAM_ERROR_CONDITION;
+#endif
+}
+
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
@@ -0,0 +1,260 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#include "libxstream_topology.hpp"
+
+#include <libxstream_begin.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#if defined(__linux__)
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+#include <libxstream_end.h>
+
+
+namespace libxstream_topology_internal {
+
+#if defined(LIBXSTREAM_NUMA) && defined(__linux__)
+// memory policy (see mbind) without depending on libnuma
+enum { mpol_preferred = 1, mpol_mf_move = 2 };
+
+
+// Read a list such as "0-3,8-11" (sysfs); returns false if there is no such file or if the list is empty.
+bool read_list(const char* filename, cpu_set_t& set)
+{
+  CPU_ZERO(&set);
+  FILE *const file = fopen(filename, "r");
+  bool result = false;
+
+  if (0 != file) {
+    int first = 0;
+    while (1 == fscanf(file, "%d", &first)) {
+      int last = first, c = fgetc(file);
+      if ('-' == c) {
+        if (1 != fscanf(file, "%d", &last)) break;
+        c = fgetc(file);
+      }
+      for (int i = std::max(first, 0); i <= last && i < CPU_SETSIZE; ++i) {
+        CPU_SET(i, &set);
+        result = true;
+      }
+      if (',' != c) break;
+    }
+    fclose(file);
+  }
+
+  return result;
+}
+#endif
+
+} // namespace libxstream_topology_internal
+
+
+const size_t libxstream_topology::npos;
+
+
+/*static*/ const libxstream_topology& libxstream_topology::instance()
+{
+  // never destroyed: host threads may outlive any static object
+  static const libxstream_topology *const topology = new libxstream_topology;
+  return *topology;
+}
+
+
+/*static*/ size_t libxstream_topology::domain(int device)
+{
+#if !defined(LIBXSTREAM_OFFLOAD)
+  return (0 <= device && static_cast<size_t>(device) < instance().ndomains()) ? static_cast<size_t>(device) : npos;
+#else
+  libxstream_use_sink(&device);
+  return npos;
+#endif
+}
+
+
+libxstream_topology::libxstream_topology()
+  : m_ndomains(0)
+{
+#if defined(__linux__)
+  cpu_set_t affinity;
+  const bool restricted = 0 == sched_getaffinity(0, sizeof(affinity), &affinity);
+# if defined(LIBXSTREAM_NUMA)
+  cpu_set_t nodes;
+  if (restricted && libxstream_topology_internal::read_list("/sys/devices/system/node/online", nodes)) {
+    for (int node = 0; node < CPU_SETSIZE && m_ndomains < (LIBXSTREAM_MAX_NDEVICES); ++node) {
+      if (CPU_ISSET(node, &nodes)) {
+        char filename[64];
+        sprintf(filename, "/sys/devices/system/node/node%d/cpulist", node);
+        domain_type& domain = m_domains[m_ndomains];
+        if (libxstream_topology_internal::read_list(filename, domain.cpus)) {
+          // only the CPUs the process is allowed to run on; memory-only nodes are not a domain
+          CPU_AND(&domain.cpus, &domain.cpus, &affinity);
+          domain.ncpus = CPU_COUNT(&domain.cpus);
+          if (0 < domain.ncpus) {
+            domain.node = node;
+            ++m_ndomains;
+          }
+        }
+      }
+    }
+  }
+# endif
+#endif
+
+  if (0 == m_ndomains) { // unknown topology
+    domain_type& domain = m_domains[0];
+    domain.node = -1;
+#if defined(__linux__)
+    if (restricted) {
+      domain.cpus = affinity;
+      domain.ncpus = CPU_COUNT(&affinity);
+    }
+    else {
+      CPU_ZERO(&domain.cpus);
+      domain.ncpus = 0;
+    }
+#else
+    domain.ncpus = 0;
+#endif
+    m_ndomains = 1;
+  }
+
+  // virtual devices can be requested without changing the application
+  const char *const env = getenv("LIBXSTREAM_NDEVICES");
+  const int ndevices = (env && 0 != *env) ? atoi(env) : (LIBXSTREAM_NDEVICES);
+  if (0 < ndevices) {
+    partition(static_cast<size_t>(ndevices));
+  }
+
+  LIBXSTREAM_PRINT_INFO("ndomains=%lu", static_cast<unsigned long>(m_ndomains));
+}
+
+
+void libxstream_topology::partition(size_t ndomains)
+{
+  ndomains = std::min<size_t>(ndomains, LIBXSTREAM_MAX_NDEVICES);
+#if defined(__linux__)
+  size_t ncpus = 0;
+  for (size_t d = 0; d < m_ndomains; ++d) ncpus += m_domains[d].ncpus;
+
+  if (0 < ncpus) {
+    // CPUs of all domains in order (along with the domain)
+    int cpus[CPU_SETSIZE], nodes[CPU_SETSIZE];
+    for (size_t d = 0, i = 0; d < m_ndomains; ++d) {
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &m_domains[d].cpus)) {
+          cpus[i] = cpu;
+          nodes[i] = m_domains[d].node;
+          ++i;
+        }
+      }
+    }
+    // contiguous partitions of (almost) equal size (CPUs are shared if there are more partitions than CPUs);
+    // a partition spanning multiple NUMA nodes is not bound to a node
+    for (size_t p = 0; p < ndomains; ++p) {
+      domain_type& domain = m_domains[p];
+      const size_t begin = std::min(p * ncpus / ndomains, ncpus - 1);
+      const size_t end = std::max((p + 1) * ncpus / ndomains, begin + 1);
+      CPU_ZERO(&domain.cpus);
+      domain.node = nodes[begin];
+      domain.ncpus = end - begin;
+      for (size_t i = begin; i < end; ++i) {
+        CPU_SET(cpus[i], &domain.cpus);
+        if (domain.node != nodes[i]) domain.node = -1;
+      }
+    }
+  }
+  else
+#endif
+  { // unknown CPUs: nothing is pinned or bound
+    for (size_t p = 0; p < ndomains; ++p) {
+#if defined(__linux__)
+      CPU_ZERO(&m_domains[p].cpus);
+#endif
+      m_domains[p].node = -1;
+      m_domains[p].ncpus = 0;
+    }
+  }
+
+  m_ndomains = ndomains;
+}
+
+
+size_t libxstream_topology::ncpus(size_t domain) const
+{
+  LIBXSTREAM_ASSERT(domain < m_ndomains);
+  return m_domains[domain].ncpus;
+}
+
+
+bool libxstream_topology::bind_thread(size_t domain) const
+{
+  bool result = false;
+  // nothing to distinguish unless there are multiple domains
+  if (domain < m_ndomains && 1 < m_ndomains && 0 < m_domains[domain].ncpus) {
+#if defined(__linux__)
+    result = 0 == sched_setaffinity(0, sizeof(m_domains[domain].cpus), &m_domains[domain].cpus);
+#endif
+  }
+  return result;
+}
+
+
+bool libxstream_topology::bind_memory(size_t domain, void* memory, size_t size) const
+{
+  bool result = false;
+  if (domain < m_ndomains && 1 < m_ndomains && 0 <= m_domains[domain].node) {
+#if defined(LIBXSTREAM_NUMA) && defined(__linux__)
+    using namespace libxstream_topology_internal;
+    // only whole pages are bound i.e., pages shared with other allocations are left as is
+    const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t begin = ((reinterpret_cast<uintptr_t>(memory) + page - 1) / page) * page;
+    const uintptr_t end = ((reinterpret_cast<uintptr_t>(memory) + size) / page) * page;
+    if (begin < end) {
+      const size_t nbits = 8 * sizeof(unsigned long);
+      unsigned long mask[CPU_SETSIZE / (8 * sizeof(unsigned long))] = { 0 };
+      const int node = m_domains[domain].node;
+      mask[node / nbits] = 1UL << (node % nbits);
+      // pages which are already touched are moved; the kernel considers one bit less than maxnode
+      result = 0 == syscall(SYS_mbind, begin, end - begin, static_cast<int>(mpol_preferred),
+        mask, static_cast<unsigned long>(8 * sizeof(mask) + 1), static_cast<unsigned int>(mpol_mf_move));
+    }
+#else
+    libxstream_use_sink(memory);
+    libxstream_use_sink(&size);
+#endif
+  }
+  return result;
+}
+
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
@@ -0,0 +1,97 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#ifndef LIBXSTREAM_TOPOLOGY_HPP
+#define LIBXSTREAM_TOPOLOGY_HPP
+
+#include "libxstream.hpp"
+
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+
+#include <libxstream_begin.h>
+#if defined(__linux__)
+# include <sched.h>
+#endif
+#include <libxstream_end.h>
+
+
+/**
+ * NUMA domains of the host (LIBXSTREAM_NUMA) i.e., the CPUs the process is allowed to run on
+ * grouped by memory locality. Unless offloading to a coprocessor, a domain is exposed as a device:
+ * the host threads executing the streams of the device are pinned to the CPUs of the domain, and
+ * memory allocated for the device is bound to the domain. There is one domain (nothing is pinned
+ * or bound) if the topology is not available. Alternatively, the CPUs are partitioned into a given
+ * number of domains (virtual devices, see LIBXSTREAM_NDEVICES).
+ */
+struct libxstream_topology {
+public:
+  static const size_t npos = static_cast<size_t>(-1);
+
+  static const libxstream_topology& instance();
+
+  // Domain of a device; npos if the device is not a domain of the host (e.g., a coprocessor).
+  static size_t domain(int device);
+
+public:
+  // Number of domains (at least one).
+  size_t ndomains() const { return m_ndomains; }
+
+  // Number of CPUs of the domain; zero if unknown.
+  size_t ncpus(size_t domain) const;
+
+  // Pin the calling thread to the CPUs of the domain; returns false if the thread is not pinned.
+  bool bind_thread(size_t domain) const;
+
+  // Bind the pages of the memory to the domain (prior to the first touch); returns false if the memory is not bound.
+  bool bind_memory(size_t domain, void* memory, size_t size) const;
+
+private:
+  libxstream_topology();
+  // Split the CPUs of all domains (in order) into the given number of domains.
+  void partition(size_t ndomains);
+  libxstream_topology(const libxstream_topology& other);
+  libxstream_topology& operator=(const libxstream_topology& other);
+
+private:
+  struct domain_type {
+    // NUMA node; negative if the domain is not a node
+    int node;
+    size_t ncpus;
+#if defined(__linux__)
+    cpu_set_t cpus;
+#endif
+  };
+
+  domain_type m_domains[LIBXSTREAM_MAX_NDEVICES];
+  size_t m_ndomains;
+};
+
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#endif // LIBXSTREAM_TOPOLOGY_HPP
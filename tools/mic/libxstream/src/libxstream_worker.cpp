@@ -0,0 +1,541 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#include "libxstream_worker.hpp"
+#include "libxstream_capture.hpp"
+#if defined(LIBXSTREAM_ASYNCHOST)
+# include "libxstream_executor.hpp"
+#endif
+
+#include <libxstream_begin.h>
+#include <cstdio>
+#include <libxstream_end.h>
+
+
+namespace libxstream_worker_internal {
+
+libxstream_capture_base *const terminator = reinterpret_cast<libxstream_capture_base*>(-1);
+
+// number of host threads executing work (see libxstream_worker::active)
+libxstream_workqueue::position_type nactive(0);
+
+
+size_t atomic_load(const libxstream_workqueue::position_type& atomic)
+{
+#if defined(LIBXSTREAM_STDFEATURES)
+  return atomic.load(std::memory_order_acquire);
+#else
+# if defined(__GNUC__)
+  __sync_synchronize();
+# endif
+  return atomic;
+#endif
+}
+
+
+void atomic_store(libxstream_workqueue::position_type& atomic, size_t value)
+{
+#if defined(LIBXSTREAM_STDFEATURES)
+  atomic.store(value, std::memory_order_release);
+#else
+# if defined(__GNUC__)
+  __sync_synchronize();
+# endif
+  atomic = value;
+#endif
+}
+
+
+void atomic_increment(libxstream_workqueue::position_type& atomic)
+{
+  // single writer (executing thread) but multiple readers
+  atomic_store(atomic, atomic_load(atomic) + 1);
+}
+
+
+// multiple writers; returns the decremented value
+size_t atomic_decrement(libxstream_workqueue::position_type& atomic)
+{
+#if defined(LIBXSTREAM_STDFEATURES)
+  return --atomic;
+#elif defined(__GNUC__)
+  return __sync_sub_and_fetch(&atomic, 1);
+#elif defined(_OPENMP)
+  size_t result = 0;
+# pragma omp critical
+  result = --atomic;
+  return result;
+#else // generic
+  for (;;) {
+    const size_t value = atomic;
+    if (reinterpret_cast<PVOID>(value) == InterlockedCompareExchangePointer(
+      reinterpret_cast<PVOID volatile*>(&atomic), reinterpret_cast<PVOID>(value - 1), reinterpret_cast<PVOID>(value)))
+    {
+      return value - 1;
+    }
+  }
+#endif
+}
+
+
+// multiple writers; returns the incremented value
+size_t atomic_add(libxstream_workqueue::position_type& atomic, size_t value)
+{
+#if defined(LIBXSTREAM_STDFEATURES)
+  return atomic += value;
+#elif defined(__GNUC__)
+  return __sync_add_and_fetch(&atomic, value);
+#elif defined(_OPENMP)
+  size_t result = 0;
+# pragma omp critical
+  result = (atomic += value);
+  return result;
+#else // generic
+  for (;;) {
+    const size_t previous = atomic;
+    if (reinterpret_cast<PVOID>(previous) == InterlockedCompareExchangePointer(
+      reinterpret_cast<PVOID volatile*>(&atomic), reinterpret_cast<PVOID>(previous + value), reinterpret_cast<PVOID>(previous)))
+    {
+      return previous + value;
+    }
+  }
+#endif
+}
+
+
+// orders a store before a subsequent load (store-load barrier)
+void atomic_fence()
+{
+#if defined(LIBXSTREAM_STDFEATURES)
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+#elif defined(__GNUC__)
+  __sync_synchronize();
+#elif defined(_OPENMP)
+# pragma omp flush
+#else
+  MemoryBarrier();
+#endif
+}
+
+
+#if defined(LIBXSTREAM_ASYNCHOST)
+bool atomic_compare_exchange(libxstream_workqueue::position_type& atomic, size_t expected, size_t desired)
+{
+#if defined(LIBXSTREAM_STDFEATURES)
+  return atomic.compare_exchange_strong(expected, desired);
+#elif defined(__GNUC__)
+  return __sync_bool_compare_and_swap(&atomic, expected, desired);
+#elif defined(_OPENMP)
+  bool result = false;
+# pragma omp critical
+  {
+    result = atomic == expected;
+    if (result) atomic = desired;
+  }
+  return result;
+#else // generic
+  return reinterpret_cast<PVOID>(expected) == InterlockedCompareExchangePointer(
+    reinterpret_cast<PVOID volatile*>(&atomic), reinterpret_cast<PVOID>(desired), reinterpret_cast<PVOID>(expected));
+#endif
+}
+#endif
+
+} // namespace libxstream_worker_internal
+
+
+void libxstream_worker::latch_type::arm(libxstream_worker& worker, size_t count)
+{
+  m_worker = &worker;
+  m_action = 0;
+  // one additional arrival (see arrive) such that the latch cannot be released while arming it
+  libxstream_worker_internal::atomic_store(m_count, count + 1);
+}
+
+
+void libxstream_worker::latch_type::arm(void (*action)(void*), void* data, size_t count)
+{
+  m_worker = 0;
+  m_action = action;
+  m_data = data;
+  libxstream_worker_internal::atomic_store(m_count, count + 1);
+}
+
+
+void libxstream_worker::latch_type::arrive()
+{
+  libxstream_worker *const worker = m_worker;
+  void (*const action)(void*) = m_action;
+  void *const data = m_data;
+  LIBXSTREAM_ASSERT(0 != worker || 0 != action);
+  // the work item (and this latch) might be destroyed as soon as the count reaches zero
+  if (0 == libxstream_worker_internal::atomic_decrement(m_count)) {
+    if (0 != worker) {
+      worker->wake();
+    }
+    else {
+      action(data);
+    }
+  }
+}
+
+
+bool libxstream_worker::latch_type::ready() const
+{
+  return 0 == libxstream_worker_internal::atomic_load(m_count);
+}
+
+
+libxstream_worker::libxstream_worker(size_t level, size_t domain)
+  : m_level(level), m_domain(domain)
+  , m_completed(0)
+  , m_entry(0)
+  , m_waiters(0)
+  , m_waiters_lock(libxstream_lock_create())
+#if defined(LIBXSTREAM_ASYNCHOST)
+  , m_scheduled(0)
+  , m_lock(libxstream_lock_create())
+#elif defined(LIBXSTREAM_STDFEATURES)
+  , m_thread() // do not start here
+#else
+  , m_thread(0)
+#endif
+{
+#if !defined(LIBXSTREAM_ASYNCHOST)
+# if defined(LIBXSTREAM_STDFEATURES)
+  std::thread(run, this).swap(m_thread);
+# elif defined(__GNUC__)
+  pthread_create(&m_thread, 0, run, this);
+# else
+  m_thread = CreateThread(0, 0, run, this, 0, 0);
+# endif
+#endif
+}
+
+
+libxstream_worker::~libxstream_worker()
+{
+  // drains the queue
+  enqueue(libxstream_worker_internal::terminator, true);
+#if defined(LIBXSTREAM_ASYNCHOST)
+  // wait until no host thread executes the worker anymore
+  while (0 != libxstream_worker_internal::atomic_load(m_scheduled)) {
+    this_thread_yield();
+  }
+  libxstream_lock_acquire(m_lock);
+  libxstream_lock_release(m_lock);
+  libxstream_lock_destroy(m_lock);
+#else
+  // the background thread terminates after executing the terminator
+# if defined(LIBXSTREAM_STDFEATURES)
+  m_thread.join();
+# elif defined(__GNUC__)
+  pthread_join(m_thread, 0);
+# else
+  WaitForSingleObject(m_thread, INFINITE);
+  CloseHandle(m_thread);
+# endif
+#endif
+  LIBXSTREAM_ASSERT(0 == m_waiters);
+  libxstream_lock_destroy(m_waiters_lock);
+#if defined(LIBXSTREAM_DEBUG)
+  size_t dangling = 0;
+  for (libxstream_workqueue::entry_type* entry = m_queue.get(); 0 != entry; entry = m_queue.get()) {
+    const libxstream_capture_base *const item = entry->item();
+    m_queue.pop(*entry);
+    if (libxstream_worker_internal::terminator != item) {
+      ++dangling;
+      delete item;
+    }
+  }
+  if (0 < dangling) {
+    LIBXSTREAM_PRINT_WARN("%lu work item%s dangling!", static_cast<unsigned long>(dangling), 1 < dangling ? "s are" : " is");
+  }
+#endif
+}
+
+
+int libxstream_worker::push(const libxstream_capture_base& capture_region, bool wait)
+{
+  libxstream_capture_base *const item = capture_region.clone();
+  LIBXSTREAM_ASSERT(0 != item);
+  const int result = enqueue(item, wait);
+  if (LIBXSTREAM_ERROR_NONE != result) {
+    delete item; // not queued
+  }
+  return result;
+}
+
+
+int libxstream_worker::enqueue(libxstream_capture_base* item, bool wait)
+{
+  const int result = m_queue.push(item, false);
+  if (LIBXSTREAM_ERROR_NONE == result) {
+    const size_t ticket = m_queue.pushed();
+#if defined(LIBXSTREAM_ASYNCHOST)
+    schedule();
+#else
+    m_parking.notify();
+#endif
+    if (wait) {
+      this->wait(ticket);
+    }
+  }
+  return result;
+}
+
+
+int libxstream_worker::status(int code)
+{
+  return m_queue.status(code);
+}
+
+
+size_t libxstream_worker::ticket() const
+{
+  return m_queue.pushed();
+}
+
+
+size_t libxstream_worker::completed() const
+{
+  return libxstream_worker_internal::atomic_load(m_completed);
+}
+
+
+void libxstream_worker::notify(waiter_type& waiter)
+{
+  libxstream_lock_acquire(m_waiters_lock);
+  waiter.next = m_waiters;
+  m_waiters = &waiter;
+  libxstream_lock_release(m_waiters_lock);
+  // the ticket might have been reached before the waiter was visible
+  libxstream_worker_internal::atomic_fence();
+  if (waiter.ticket <= completed()) {
+    notify_waiters();
+  }
+}
+
+
+void libxstream_worker::notify_waiters()
+{
+  waiter_type* reached = 0;
+  libxstream_lock_acquire(m_waiters_lock);
+  const size_t ticket = completed();
+  for (waiter_type *w = m_waiters, *prev = 0, *next = 0; 0 != w; w = next) {
+    next = w->next;
+    if (w->ticket <= ticket) {
+      (prev ? prev->next : m_waiters) = next;
+      w->next = reached;
+      reached = w;
+    }
+    else {
+      prev = w;
+    }
+  }
+  libxstream_lock_release(m_waiters_lock);
+
+  while (0 != reached) {
+    // read before arriving: the waiter might be destroyed afterwards
+    waiter_type *const next = reached->next;
+    reached->latch->arrive();
+    reached = next;
+  }
+}
+
+
+void libxstream_worker::wake()
+{
+#if defined(LIBXSTREAM_ASYNCHOST)
+  schedule();
+#else
+  m_parking.notify();
+#endif
+}
+
+
+void libxstream_worker::wait(size_t ticket) const
+{
+  libxstream_parking& parking = progress();
+  for (;;) {
+    const size_t key = parking.key();
+    if (ticket <= completed()) break;
+    parking.wait(key);
+  }
+}
+
+
+/*static*/ size_t libxstream_worker::nactive()
+{
+  return libxstream_worker_internal::atomic_load(libxstream_worker_internal::nactive);
+}
+
+
+/*static*/ void libxstream_worker::active(bool busy)
+{
+  if (busy) {
+    libxstream_worker_internal::atomic_add(libxstream_worker_internal::nactive, 1);
+  }
+  else {
+    libxstream_worker_internal::atomic_decrement(libxstream_worker_internal::nactive);
+  }
+}
+
+
+/*static*/ libxstream_parking& libxstream_worker::progress()
+{
+  // never destroyed: threads may wait beyond the lifetime of static objects
+  static libxstream_parking *const parking = new libxstream_parking;
+  return *parking;
+}
+
+
+libxstream_worker::step_type libxstream_worker::step()
+{
+  if (0 == m_entry) {
+    m_entry = m_queue.get();
+    if (0 == m_entry) return step_empty;
+  }
+
+  libxstream_capture_base *const capture_region = m_entry->item();
+  step_type result = step_terminated;
+
+  if (libxstream_worker_internal::terminator != capture_region) {
+    if (!capture_region->ready()) return step_pending;
+    (*capture_region)();
+    delete capture_region;
+    result = step_executed;
+  }
+
+  libxstream_worker_internal::atomic_increment(m_completed);
+  m_queue.pop(*m_entry);
+  m_entry = 0;
+  // successors waiting for this worker are woken directly
+  libxstream_worker_internal::atomic_fence();
+  if (0 != m_waiters) {
+    notify_waiters();
+  }
+  progress().notify();
+  return result;
+}
+
+
+#if defined(LIBXSTREAM_ASYNCHOST)
+
+bool libxstream_worker::execute(size_t budget, size_t& nexecuted)
+{
+  using namespace libxstream_worker_internal;
+  bool result = true;
+  nexecuted = 0;
+
+  libxstream_lock_acquire(m_lock);
+  while (nexecuted < budget) {
+    const step_type s = step();
+    if (step_executed == s) {
+      ++nexecuted;
+      // yield to a more urgent worker (remains scheduled)
+      if (libxstream_executor::instance().urgent(m_level)) break;
+    }
+    else if (step_pending == s) {
+      // unscheduled until the last predecessor wakes the worker
+      atomic_store(m_scheduled, 0);
+      atomic_fence();
+      // the predecessors might have arrived before unscheduling
+      result = m_entry->item()->ready() && atomic_compare_exchange(m_scheduled, 0, 1);
+      break;
+    }
+    else {
+      atomic_store(m_scheduled, 0);
+      // pairs with the fence in schedule: either the producer sees the worker unscheduled, or the work is seen here
+      atomic_fence();
+      // work might have been published after finding the queue empty but before unscheduling;
+      // an entry which is reserved but not published yet is scheduled by its producer
+      result = step_empty == s && m_queue.published() && atomic_compare_exchange(m_scheduled, 0, 1);
+      break;
+    }
+  }
+  libxstream_lock_release(m_lock);
+
+  return result;
+}
+
+
+void libxstream_worker::schedule()
+{
+  using namespace libxstream_worker_internal;
+  // the work (or the arrival of the last predecessor) is published before checking whether the worker is scheduled
+  atomic_fence();
+  if (0 == atomic_load(m_scheduled) && atomic_compare_exchange(m_scheduled, 0, 1)) {
+    libxstream_executor::instance().schedule(*this);
+  }
+}
+
+#else
+
+# if defined(LIBXSTREAM_STDFEATURES) || defined(__GNUC__)
+/*static*/ void* libxstream_worker::run(void* worker)
+# else
+/*static*/ DWORD WINAPI libxstream_worker::run(_In_ LPVOID worker)
+# endif
+{
+  libxstream_worker& w = *static_cast<libxstream_worker*>(worker);
+  libxstream_topology::instance().bind_thread(w.m_domain);
+  bool busy = false;
+
+  for (;;) {
+    // key is obtained prior to checking for work
+    const size_t key = w.m_parking.key();
+    if (!busy) {
+      active(true);
+      busy = true;
+    }
+    const step_type s = w.step();
+    if (step_empty == s || step_pending == s) {
+      active(false);
+      busy = false;
+      // woken by the producer or by the last predecessor of the pending work item
+      w.m_parking.wait(key);
+    }
+    else if (step_terminated == s) {
+      break;
+    }
+  }
+  if (busy) active(false);
+
+# if defined(LIBXSTREAM_STDFEATURES) || defined(__GNUC__)
+  return worker;
+# else
+  return EXIT_SUCCESS;
+# endif
+}
+
+#endif
+
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
@@ -0,0 +1,196 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#ifndef LIBXSTREAM_WORKER_HPP
+#define LIBXSTREAM_WORKER_HPP
+
+#include "libxstream_workqueue.hpp"
+#include "libxstream_parking.hpp"
+#include "libxstream_topology.hpp"
+
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+
+// number of priority levels distinguished when executing the workers
+#if defined(LIBXSTREAM_ASYNCHOST) && defined(LIBXSTREAM_PRIORITY_NLEVELS) && (1 < (LIBXSTREAM_PRIORITY_NLEVELS))
+# define LIBXSTREAM_WORKER_NLEVELS (LIBXSTREAM_PRIORITY_NLEVELS)
+#else
+# define LIBXSTREAM_WORKER_NLEVELS 1
+#endif
+
+#include <libxstream_begin.h>
+#if defined(LIBXSTREAM_STDFEATURES)
+# include <thread>
+#elif defined(__GNUC__)
+# include <pthread.h>
+#else
+# include <Windows.h>
+#endif
+#include <libxstream_end.h>
+
+
+/**
+ * Work queue executing the queued capture regions in order. Every stream owns a worker
+ * such that independent streams execute concurrently; work which is not associated with
+ * a stream goes to a shared worker. A worker is either executed by the pool of host
+ * threads (LIBXSTREAM_ASYNCHOST) or by an own background thread.
+ */
+struct libxstream_worker {
+public:
+  /**
+   * Counts the predecessors a work item depends on; the worker executing the work item
+   * (successor) is woken by the last arriving predecessor i.e., the worker is not polling.
+   */
+  class latch_type {
+  public:
+    latch_type(): m_worker(0), m_action(0), m_data(0), m_count(0) {}
+  public:
+    // Prepare for the given number of predecessors; the worker is woken once all arrived.
+    void arm(libxstream_worker& worker, size_t count);
+    // Prepare for the given number of predecessors; action(data) is called by the last arriving predecessor.
+    void arm(void (*action)(void*), void* data, size_t count);
+    // Called once per predecessor.
+    void arrive();
+    bool ready() const;
+  private:
+    latch_type(const latch_type& other);
+    latch_type& operator=(const latch_type& other);
+  private:
+    libxstream_worker* m_worker;
+    void (*m_action)(void*);
+    void* m_data;
+    libxstream_workqueue::position_type m_count;
+  };
+
+  // Successor waiting for a worker (predecessor) to reach a ticket.
+  struct waiter_type {
+    latch_type* latch;
+    size_t ticket;
+    waiter_type* next;
+  };
+
+public:
+  // Level zero is the least urgent level (see LIBXSTREAM_WORKER_NLEVELS); the worker is
+  // executed by host threads of the given domain (libxstream_topology) unless it is npos.
+  explicit libxstream_worker(size_t level = 0, size_t domain = libxstream_topology::npos);
+  ~libxstream_worker();
+
+public:
+  // Priority level of the worker.
+  size_t level() const { return m_level; }
+
+  // Domain of the host threads executing the worker (libxstream_topology::npos if any).
+  size_t domain() const { return m_domain; }
+
+  // Clone and enqueue the capture region; waits for its completion if requested.
+  int push(const libxstream_capture_base& capture_region, bool wait);
+
+  // Exchange the status code of the worker.
+  int status(int code);
+
+  // Ticket which is reached once all work enqueued so far is completed.
+  size_t ticket() const;
+  // Number of completed work items.
+  size_t completed() const;
+  // Wait until the given ticket is reached.
+  void wait(size_t ticket) const;
+
+  // Arrive at the waiter's latch once the ticket is reached (immediately if the ticket is reached already).
+  void notify(waiter_type& waiter);
+
+  // Resume a worker which was waiting for its predecessors.
+  void wake();
+
+  // Threads waiting for the progress of any worker (completed or scheduled work).
+  static libxstream_parking& progress();
+
+  // Number of host threads executing work rather than waiting for work.
+  static size_t nactive();
+  // Account a host thread which starts (busy) or stops executing work.
+  static void active(bool busy);
+
+#if defined(LIBXSTREAM_ASYNCHOST)
+  // Execute up to budget work items (in order) and count the executed items.
+  // Returns false if the worker went idle i.e., it is not scheduled anymore.
+  bool execute(size_t budget, size_t& nexecuted);
+#endif
+
+private:
+  libxstream_worker(const libxstream_worker& other);
+  libxstream_worker& operator=(const libxstream_worker& other);
+
+  // Enqueue an item; waits for its completion if requested.
+  int enqueue(libxstream_capture_base* item, bool wait);
+
+  enum step_type { step_executed, step_empty, step_pending, step_terminated };
+  // Execute the next work item unless the queue is empty or the item is not ready.
+  step_type step();
+
+  // Arrive at the latches of the waiters whose ticket is reached.
+  void notify_waiters();
+
+#if defined(LIBXSTREAM_ASYNCHOST)
+  // Hand the worker to the executor unless it is already scheduled.
+  void schedule();
+#else
+# if defined(LIBXSTREAM_STDFEATURES) || defined(__GNUC__)
+  static void* run(void* worker);
+# else
+  static DWORD WINAPI run(_In_ LPVOID worker);
+# endif
+#endif
+
+private:
+  libxstream_workqueue m_queue;
+  size_t m_level, m_domain;
+  libxstream_workqueue::position_type m_completed;
+  // claimed entry which is not executed yet (not ready)
+  libxstream_workqueue::entry_type* m_entry;
+  // successors waiting for tickets of this worker
+  waiter_type* volatile m_waiters;
+  libxstream_lock* m_waiters_lock;
+#if defined(LIBXSTREAM_ASYNCHOST)
+  libxstream_workqueue::position_type m_scheduled;
+  // held while a host thread executes the worker
+  libxstream_lock* m_lock;
+#else
+  // parks the background thread while waiting for work
+  libxstream_parking m_parking;
+# if defined(LIBXSTREAM_STDFEATURES)
+  std::thread m_thread;
+# elif defined(__GNUC__)
+  pthread_t m_thread;
+# else
+  HANDLE m_thread;
+# endif
+#endif
+};
+
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#endif // LIBXSTREAM_WORKER_HPP
@@ -0,0 +1,261 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#include "libxstream_workqueue.hpp"
+
+#include <libxstream_begin.h>
+#include <cstdio>
+#include <libxstream_end.h>
+
+
+namespace libxstream_workqueue_internal {
+
+size_t atomic_load(const libxstream_workqueue::position_type& atomic)
+{
+#if defined(LIBXSTREAM_STDFEATURES)
+  return atomic.load(std::memory_order_acquire);
+#else
+# if defined(__GNUC__)
+  __sync_synchronize();
+# endif
+  return atomic;
+#endif
+}
+
+
+void atomic_store(libxstream_workqueue::position_type& atomic, size_t value)
+{
+#if defined(LIBXSTREAM_STDFEATURES)
+  atomic.store(value, std::memory_order_release);
+#else
+# if defined(__GNUC__)
+  __sync_synchronize();
+# endif
+  atomic = value;
+#endif
+}
+
+
+bool atomic_compare_exchange(libxstream_workqueue::position_type& atomic, size_t expected, size_t desired, libxstream_lock* lock)
+{
+#if defined(LIBXSTREAM_STDFEATURES)
+  libxstream_use_sink(lock);
+  return atomic.compare_exchange_weak(expected, desired, std::memory_order_relaxed);
+#elif defined(__GNUC__)
+  libxstream_use_sink(lock);
+  return __sync_bool_compare_and_swap(&atomic, expected, desired);
+#elif defined(_OPENMP)
+  libxstream_use_sink(lock);
+  bool result = false;
+# pragma omp critical
+  {
+    result = atomic == expected;
+    if (result) atomic = desired;
+  }
+  return result;
+#else // generic
+  libxstream_lock_acquire(lock);
+  const bool result = atomic == expected;
+  if (result) atomic = desired;
+  libxstream_lock_release(lock);
+  return result;
+#endif
+}
+
+} // namespace libxstream_workqueue_internal
+
+
+libxstream_workqueue::libxstream_workqueue()
+  : m_push(0), m_pop(0)
+#if defined(LIBXSTREAM_STDFEATURES)
+  , m_status(LIBXSTREAM_ERROR_NONE)
+#else
+  , m_lock(libxstream_lock_create())
+  , m_status(LIBXSTREAM_ERROR_NONE)
+#endif
+{
+  for (size_t i = 0; i < (LIBXSTREAM_MAX_QSIZE); ++i) {
+    libxstream_workqueue_internal::atomic_store(m_buffer[i].m_sequence, i);
+  }
+}
+
+
+libxstream_workqueue::~libxstream_workqueue()
+{
+#if !defined(LIBXSTREAM_STDFEATURES)
+  libxstream_lock_destroy(m_lock);
+#endif
+}
+
+
+int libxstream_workqueue::push(libxstream_capture_base* item, bool wait)
+{
+  using namespace libxstream_workqueue_internal;
+  LIBXSTREAM_ASSERT(0 != item);
+#if defined(LIBXSTREAM_STDFEATURES)
+  libxstream_lock *const lock = 0;
+#else
+  libxstream_lock *const lock = m_lock;
+#endif
+  size_t position = atomic_load(m_push);
+  entry_type* entry = 0;
+#if defined(LIBXSTREAM_DEBUG)
+  bool stalled = false;
+#endif
+
+  for (;;) {
+    entry = m_buffer + (position % (LIBXSTREAM_MAX_QSIZE));
+    const size_t sequence = atomic_load(entry->m_sequence);
+    const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+    if (0 == diff) { // entry is free
+      if (atomic_compare_exchange(m_push, position, position + 1, lock)) break;
+      position = atomic_load(m_push);
+    }
+    else if (0 > diff) { // queue is full
+#if defined(LIBXSTREAM_QUEUE_NOWAIT)
+      return LIBXSTREAM_ERROR_RUNTIME;
+#else
+# if defined(LIBXSTREAM_DEBUG)
+      if (!stalled) {
+        LIBXSTREAM_PRINT_WARN0("queuing work is stalled!");
+        stalled = true;
+      }
+# endif
+      this_thread_yield();
+      position = atomic_load(m_push);
+#endif
+    }
+    else { // another producer was faster
+      position = atomic_load(m_push);
+    }
+  }
+
+  entry->m_item = item;
+  atomic_store(entry->m_sequence, position + 1); // publish
+
+  if (wait) {
+    while ((position + 1) == atomic_load(entry->m_sequence)) {
+      this_thread_yield();
+    }
+  }
+
+  return LIBXSTREAM_ERROR_NONE;
+}
+
+
+libxstream_workqueue::entry_type* libxstream_workqueue::get()
+{
+  using namespace libxstream_workqueue_internal;
+#if defined(LIBXSTREAM_STDFEATURES)
+  libxstream_lock *const lock = 0;
+#else
+  libxstream_lock *const lock = m_lock;
+#endif
+  size_t position = atomic_load(m_pop);
+
+  for (;;) {
+    entry_type *const entry = m_buffer + (position % (LIBXSTREAM_MAX_QSIZE));
+    const size_t sequence = atomic_load(entry->m_sequence);
+    const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+
+    if (0 == diff) { // entry is published
+      if (atomic_compare_exchange(m_pop, position, position + 1, lock)) return entry;
+      position = atomic_load(m_pop);
+    }
+    else if (0 > diff) { // queue is empty
+      return 0;
+    }
+    else { // another consumer was faster
+      position = atomic_load(m_pop);
+    }
+  }
+}
+
+
+void libxstream_workqueue::pop(entry_type& entry)
+{
+  using namespace libxstream_workqueue_internal;
+  const size_t sequence = atomic_load(entry.m_sequence);
+  LIBXSTREAM_ASSERT(0 < sequence);
+#if defined(LIBXSTREAM_DEBUG)
+  entry.m_item = 0;
+#endif
+  // the entry is free for the producer which is one round ahead
+  atomic_store(entry.m_sequence, sequence - 1 + (LIBXSTREAM_MAX_QSIZE));
+}
+
+
+size_t libxstream_workqueue::size() const
+{
+  using namespace libxstream_workqueue_internal;
+  const size_t pop = atomic_load(m_pop), push = atomic_load(m_push);
+  return pop < push ? (push - pop) : 0;
+}
+
+
+bool libxstream_workqueue::published() const
+{
+  using namespace libxstream_workqueue_internal;
+  const size_t position = atomic_load(m_pop);
+  const entry_type& entry = m_buffer[position % (LIBXSTREAM_MAX_QSIZE)];
+  return (position + 1) == atomic_load(entry.m_sequence);
+}
+
+
+size_t libxstream_workqueue::pushed() const
+{
+  return libxstream_workqueue_internal::atomic_load(m_push);
+}
+
+
+int libxstream_workqueue::status(int code)
+{
+#if defined(LIBXSTREAM_STDFEATURES)
+  return std::atomic_exchange(&m_status, code);
+#elif defined(_OPENMP)
+  int result = 0;
+# pragma omp critical
+  {
+    result = m_status;
+    m_status = code;
+  }
+  return result;
+#else // generic
+  libxstream_lock_acquire(m_lock);
+  const int result = m_status;
+  m_status = code;
+  libxstream_lock_release(m_lock);
+  return result;
+#endif
+}
+
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
@@ -0,0 +1,120 @@
+/******************************************************************************
+** Copyright (c) 2014-2015, Intel Corporation                                **
+** All rights reserved.                                                      **
+**                                                                           **
+** Redistribution and use in source and binary forms, with or without        **
+** modification, are permitted provided that the following conditions        **
+** are met:                                                                  **
+** 1. Redistributions of source code must retain the above copyright         **
+**    notice, this list of conditions and the following disclaimer.          **
+** 2. Redistributions in binary form must reproduce the above copyright      **
+**    notice, this list of conditions and the following disclaimer in the    **
+**    documentation and/or other materials provided with the distribution.   **
+** 3. Neither the name of the copyright holder nor the names of its          **
+**    contributors may be used to endorse or promote products derived        **
+**    from this software without specific prior written permission.          **
+**                                                                           **
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       **
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         **
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR     **
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT      **
+** HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,    **
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED  **
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR    **
+** PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    **
+** LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      **
+** NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        **
+** SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              **
+******************************************************************************/
+/* Hans Pabst (Intel Corp.)
+******************************************************************************/
+#ifndef LIBXSTREAM_WORKQUEUE_HPP
+#define LIBXSTREAM_WORKQUEUE_HPP
+
+#include "libxstream.hpp"
+
+#if defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+
+#include <libxstream_begin.h>
+#if defined(LIBXSTREAM_STDFEATURES)
+# include <atomic>
+#endif
+#include <libxstream_end.h>
+
+
+struct libxstream_capture_base;
+
+
+/**
+ * Bounded multi-producer/multi-consumer queue with LIBXSTREAM_MAX_QSIZE entries.
+ * Each entry carries a sequence number which tells whether the entry is free,
+ * published by a producer, or claimed by a consumer (no global lock).
+ */
+struct libxstream_workqueue {
+public:
+#if defined(LIBXSTREAM_STDFEATURES)
+  typedef std::atomic<size_t> position_type;
+#else
+  typedef volatile size_t position_type;
+#endif
+
+  class entry_type {
+  public:
+    entry_type(): m_sequence(0), m_item(0) {}
+    libxstream_capture_base* item() const { return m_item; }
+  private:
+    friend struct libxstream_workqueue;
+    position_type m_sequence;
+    libxstream_capture_base* m_item;
+  };
+
+public:
+  libxstream_workqueue();
+  ~libxstream_workqueue();
+
+public:
+  // Publish an item; waits for the completion of the item if requested.
+  // A full queue blocks the caller or fails (see LIBXSTREAM_QUEUE_NOWAIT).
+  int push(libxstream_capture_base* item, bool wait);
+
+  // Claim the oldest published entry; returns NULL if the queue is empty.
+  entry_type* get();
+
+  // Release an entry (previously claimed by get) i.e., the item was executed.
+  void pop(entry_type& entry);
+
+  // Number of published entries which are not claimed yet (snapshot).
+  size_t size() const;
+  bool empty() const { return 0 == size(); }
+
+  // Whether the oldest entry is published i.e., get would not return NULL (snapshot).
+  bool published() const;
+
+  // Number of entries pushed so far (including entries which are not yet published).
+  size_t pushed() const;
+
+  // Exchange the status code of the queue.
+  int status(int code);
+
+private:
+  libxstream_workqueue(const libxstream_workqueue& other);
+  libxstream_workqueue& operator=(const libxstream_workqueue& other);
+
+private:
+  entry_type m_buffer[LIBXSTREAM_MAX_QSIZE];
+  // avoid false sharing between producers and consumers
+  char m_pad0[LIBXSTREAM_MAX_SIMD];
+  position_type m_push;
+  char m_pad1[LIBXSTREAM_MAX_SIMD];
+  position_type m_pop;
+  char m_pad2[LIBXSTREAM_MAX_SIMD];
+#if defined(LIBXSTREAM_STDFEATURES)
+  std::atomic<int> m_status;
+#else
+  libxstream_lock* m_lock;
+  int m_status;
+#endif
+};
+
+#endif // defined(LIBXSTREAM_EXPORTED) || defined(__LIBXSTREAM)
+#endif // LIBXSTREAM_WORKQUEUE_HPP